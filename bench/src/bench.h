@@ -0,0 +1,22 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+//  Manual benchmarks for the library (one report line per measurement)
+//===========================================
+#ifndef _7B7B_BENCH_H
+#define _7B7B_BENCH_H
+
+#include <QStringList>
+
+//Type-to-launch search: index "count" generated entries and time a set of typical queries
+QStringList benchSearch(int count, int rounds);
+//Full XDGDesktopList::updateList() scans: serial vs parallel parse, cold vs warm index
+QStringList benchUpdateList(int rounds);
+//XDGDesktop::sync() over every *.desktop file in the system app dirs
+QStringList benchSync(int rounds);
+//LMimeGlobs::match() over "count" names built from the installed mime database
+QStringList benchGlobs(int count, int rounds);
+
+#endif
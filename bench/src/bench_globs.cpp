@@ -0,0 +1,82 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "bench.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegularExpression>
+
+#include <LMimeDatabase.h>
+#include <LMimeGlobs.h>
+#include <LuminaXDG.h>
+
+//Classify every name "rounds" times: average time per name and how many got a type
+static QString timeMatch(QString label, const LMimeGlobs *globs, const QStringList &names, int rounds) {
+    int found = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for(int r=0; r<rounds; r++) {
+        found = 0;
+        for(int i=0; i<names.length(); i++) {
+            if(!globs->match(names[i]).isEmpty()) {
+                found++;
+            }
+        }
+    }
+    double ns = timer.nsecsElapsed()/(double) rounds/names.length();
+    return QString("%1: avg %2 ns per name (%3/%4 matched)").arg(label).arg(ns, 0, 'f', 0).arg(found).arg(names.length());
+}
+
+QStringList benchGlobs(int count, int rounds) {
+    count = qMax(count, 1);
+    rounds = qMax(rounds, 1);
+    QStringList out;
+    std::shared_ptr<const LMimeGlobs> db = LMimeDatabase::instance()->globs();
+    //Filenames built from the database patterns: suffixes (some upper-case), literal names and unknown extensions
+    QStringList lines = db->lines();
+    QStringList suffixes, literals;
+    QRegularExpression wild("[\\*\\?\\[]");
+    for(int i=0; i<lines.length(); i++) {
+        QString pattern = lines[i].section(":",2,2);
+        if(pattern.startsWith("*.") && !pattern.mid(1).contains(wild)) {
+            suffixes << pattern.mid(1);
+        } else if(!pattern.isEmpty() && !pattern.contains(wild)) {
+            literals << pattern;
+        }
+    }
+    if(suffixes.isEmpty()) {
+        out << "no glob patterns found in the mime database";
+        return out;
+    }
+    QStringList names;
+    for(int i=0; i<count; i++) {
+        if(i%8==7) {
+            names << "file"+QString::number(i)+".qzx"+QString::number(i%13);
+        } else if(i%8==6 && !literals.isEmpty()) {
+            names << literals[i%literals.length()];
+        } else {
+            QString suffix = suffixes[ (int)( ((qint64) i*7919) % suffixes.length() ) ];
+            names << "file"+QString::number(i)+( (i%4==3) ? suffix.toUpper() : suffix );
+        }
+    }
+    out << QString("names: %1 (%2 suffix / %3 literal patterns)").arg(names.length()).arg(suffixes.length()).arg(literals.length());
+    out << timeMatch("system database", db.get(), names, rounds);
+    //Same names against the compiled text globs2 files (used when there is no mime.cache)
+    QStringList dirs = LXDG::systemMimeDirs();
+    LMimeGlobs text;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i=0; i<dirs.length(); i++) {
+        if(QFile::exists(dirs[i]+"/globs2")) {
+            text.loadGlobs2(dirs[i]+"/globs2");
+        }
+    }
+    if(!text.isEmpty()) {
+        out << QString("globs2 compile: %1 ms").arg(timer.nsecsElapsed()/1000000.0, 0, 'f', 1);
+        out << timeMatch("globs2", &text, names, rounds);
+    }
+    return out;
+}
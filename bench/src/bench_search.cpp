@@ -0,0 +1,66 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "bench.h"
+
+#include <QElapsedTimer>
+
+#include <LDesktopSearch.h>
+#include <LuminaXDG.h>
+
+QStringList benchSearch(int count, int rounds) {
+    //Names/keywords built from a small word list, so the postings overlap like a real app list
+    static const char *words[] = { "Terminal", "Image", "Viewer", "Editor", "Office", "Writer", "Music", "Player", "Video", "Mail",
+                                   "Browser", "Archive", "Manager", "Calculator", "Settings", "Files", "Photo", "Text", "Network", "System" };
+    static const int nwords = sizeof(words)/sizeof(words[0]);
+    count = qMax(count, 1);
+    rounds = qMax(rounds, 1);
+    QList<XDGDesktop*> apps;
+    for(int i=0; i<count; i++) {
+        XDGDesktop *desk = new XDGDesktop();
+        desk->name = QString(words[i%nwords])+" "+words[(i/nwords)%nwords]+" "+QString::number(i);
+        desk->genericName = QString(words[(i*7)%nwords])+" "+words[(i*3)%nwords];
+        desk->keyList << words[(i*11)%nwords] << QString::fromUtf8("Édition") << QString::number(i*13);
+        desk->comment = "Benchmark entry "+QString::number(i)+" for the "+words[(i*5)%nwords]+" category";
+        apps << desk;
+    }
+    QStringList out;
+    LDesktopSearch index;
+    QElapsedTimer timer;
+    timer.start();
+    index.build(apps);
+    out << QString("build: %1 entries in %2 ms").arg(count).arg(timer.nsecsElapsed()/1000000.0, 0, 'f', 1);
+    //Fresh queries (previous state cleared each time): prefix, trigram, accents, typo, no match
+    QStringList queries;
+    queries << "t" << "te" << "ter" << "terminal" << "image viewer" << "edition" << "imgae" << "qzxw";
+    for(int q=0; q<queries.length(); q++) {
+        qint64 total = 0, worst = 0;
+        int found = 0;
+        for(int r=0; r<rounds; r++) {
+            index.search("");
+            timer.restart();
+            found = index.search(queries[q], 10).length();
+            qint64 ns = timer.nsecsElapsed();
+            total += ns;
+            worst = qMax(worst, ns);
+        }
+        out << QString("\"%1\": avg %2 us, max %3 us (%4 results)").arg(queries[q]).arg(total/rounds/1000.0, 0, 'f', 1).arg(worst/1000.0, 0, 'f', 1).arg(found);
+    }
+    //Typing a query one character at a time (refines the previous matches)
+    QString typed = "calculator";
+    qint64 worst = 0;
+    for(int r=0; r<rounds; r++) {
+        index.search("");
+        for(int i=1; i<=typed.length(); i++) {
+            timer.restart();
+            index.search(typed.left(i), 10);
+            worst = qMax(worst, timer.nsecsElapsed());
+        }
+    }
+    out << QString("typing \"%1\": max %2 us per keystroke").arg(typed).arg(worst/1000.0, 0, 'f', 1);
+    index.clear();
+    qDeleteAll(apps);
+    return out;
+}
@@ -0,0 +1,51 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "bench.h"
+
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <LuminaXDG.h>
+
+QStringList benchSync(int rounds) {
+    rounds = qMax(rounds, 1);
+    QStringList out;
+    //Every *.desktop file in the system app dirs (including the vendor subdirs)
+    QStringList dirs = LXDG::systemApplicationDirs();
+    QList<XDGDesktop*> desks;
+    qint64 bytes = 0;
+    for(int i=0; i<dirs.length(); i++) {
+        QDirIterator it(dirs[i], QStringList() << "*.desktop", QDir::Files, QDirIterator::Subdirectories);
+        while(it.hasNext()) {
+            QString path = it.next();
+            bytes += QFileInfo(path).size();
+            desks << new XDGDesktop(path); //first read also warms up the page cache
+        }
+    }
+    if(desks.isEmpty()) {
+        out << "no *.desktop files found";
+        return out;
+    }
+    //Re-read the same entries so only sync() itself gets timed
+    qint64 total = 0, worst = 0;
+    QElapsedTimer timer;
+    for(int r=0; r<rounds; r++) {
+        timer.start();
+        for(int i=0; i<desks.length(); i++) {
+            desks[i]->sync();
+        }
+        qint64 ns = timer.nsecsElapsed();
+        total += ns;
+        worst = qMax(worst, ns);
+    }
+    double avg = total/(double) rounds;
+    out << QString("sync: %1 files (%2 KiB)").arg(desks.length()).arg(bytes/1024);
+    out << QString("per pass: avg %1 ms, max %2 ms").arg(avg/1000000.0, 0, 'f', 2).arg(worst/1000000.0, 0, 'f', 2);
+    out << QString("per file: avg %1 us, %2 MiB/s").arg(avg/desks.length()/1000.0, 0, 'f', 2).arg( (bytes/(1024.0*1024.0)) / (avg/1000000000.0), 0, 'f', 1);
+    qDeleteAll(desks);
+    return out;
+}
@@ -0,0 +1,64 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "bench.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <LDesktopIndex.h>
+#include <LuminaXDG.h>
+
+//Time one full scan with a fresh list (no dir watches), average/worst over "rounds"
+static QString timeScan(QString label, bool cold, int rounds) {
+    qint64 total = 0, worst = 0;
+    int found = 0;
+    QElapsedTimer timer;
+    for(int r=0; r<rounds; r++) {
+        if(cold) {
+            QFile::remove(LDesktopIndex::indexPath());
+        }
+        XDGDesktopList *list = new XDGDesktopList(0, false);
+        timer.start();
+        list->updateList();
+        qint64 ns = timer.nsecsElapsed();
+        total += ns;
+        worst = qMax(worst, ns);
+        found = list->files.count();
+        delete list;
+        QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete); //retired entries
+    }
+    return QString("%1: avg %2 ms, max %3 ms (%4 files)").arg(label).arg(total/rounds/1000000.0, 0, 'f', 1).arg(worst/1000000.0, 0, 'f', 1).arg(found);
+}
+
+QStringList benchUpdateList(int rounds) {
+    rounds = qMax(rounds, 1);
+    QStringList out;
+    //Keep the on-disk index out of the user's cache dir
+    QTemporaryDir cache;
+    if(!cache.isValid()) {
+        out << "could not create a temporary cache dir";
+        return out;
+    }
+    QByteArray oldcache = qgetenv("XDG_CACHE_HOME");
+    qputenv("XDG_CACHE_HOME", cache.path().toLocal8Bit());
+    int threads = XDGDesktopList::parseThreads();
+    //Serial parse vs the thread pool - cold (no index) and warm (index written by the previous scan)
+    XDGDesktopList::setParseThreads(1);
+    out << timeScan("1 thread, cold", true, rounds);
+    out << timeScan("1 thread, warm", false, rounds);
+    XDGDesktopList::setParseThreads(threads);
+    out << timeScan(QString("%1 threads, cold").arg(threads), true, rounds);
+    out << timeScan(QString("%1 threads, warm").arg(threads), false, rounds);
+    if(oldcache.isNull()) {
+        qunsetenv("XDG_CACHE_HOME");
+    } else {
+        qputenv("XDG_CACHE_HOME", oldcache);
+    }
+    return out;
+}
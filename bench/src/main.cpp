@@ -0,0 +1,46 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include <QCoreApplication>
+#include <QString>
+#include <QTextStream>
+
+#include "bench.h"
+
+static void usage(QTextStream &out) {
+    out << "Usage: 7b7b-bench <benchmark> [options]\n";
+    out << "  search [count] [rounds]   type-to-launch search over generated entries (default: 5000 200)\n";
+    out << "  updatelist [rounds]       app dir scans, 1 thread vs all cores, cold vs warm index (default: 5)\n";
+    out << "  sync [rounds]             re-read every installed *.desktop file (default: 50)\n";
+    out << "  globs [count] [rounds]    filename -> mimetype matching (default: 10000 20)\n";
+}
+
+int main(int argc, char ** argv)
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+    QStringList args = a.arguments();
+    args.removeFirst();
+    if(args.isEmpty()) {
+        usage(out);
+        return 1;
+    }
+    QString which = args.takeFirst();
+    QStringList report;
+    if(which=="search") {
+        report = benchSearch( args.value(0,"5000").toInt(), args.value(1,"200").toInt() );
+    } else if(which=="updatelist") {
+        report = benchUpdateList( args.value(0,"5").toInt() );
+    } else if(which=="sync") {
+        report = benchSync( args.value(0,"50").toInt() );
+    } else if(which=="globs") {
+        report = benchGlobs( args.value(0,"10000").toInt(), args.value(1,"20").toInt() );
+    } else {
+        usage(out);
+        return 1;
+    }
+    out << report.join("\n") << "\n";
+    return 0;
+}
@@ -0,0 +1,231 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "MimeDefaultsModel.h"
+
+//Internal ID for the index: 0 for groups, <group number>+1 for mimetype rows
+
+MimeDefaultsModel::MimeDefaultsModel(QObject *parent) : QAbstractItemModel(parent) {
+
+}
+
+MimeDefaultsModel::~MimeDefaultsModel() {
+
+}
+
+void MimeDefaultsModel::load(QStringList defMimeList) {
+    beginResetModel();
+    groups.clear();
+    appinfo.clear();
+    defMimeList.sort(); //sort by group/mime
+    for(int i=0; i<defMimeList.length(); i++) {
+        //Get the info from this entry
+        mime_entry entry;
+        entry.mime = defMimeList[i].section("::::",0,0);
+        entry.extlist = defMimeList[i].section("::::",1,1);
+        entry.def = defMimeList[i].section("::::",2,2);
+        entry.comment = defMimeList[i].section("::::",3,50);
+        //Now check if this is a new category
+        QString cat = entry.mime.section("/",0,0);
+        if(groups.isEmpty() || groups.last().name!=cat) {
+            mime_group group;
+            group.name = cat;
+            group.fetched = 0;
+            groups << group;
+        }
+        groups.last().entries << entry;
+    }
+    endResetModel();
+}
+
+QStringList MimeDefaultsModel::mimeTypes(const QModelIndex &index) const {
+    QStringList out;
+    if(!index.isValid()) {
+        return out;
+    }
+    if(index.internalId()==0) {
+        const QList<mime_entry> &entries = groups[index.row()].entries;
+        for(int i=0; i<entries.length(); i++) {
+            out << entries[i].mime;
+        }
+    }
+    else {
+        out << groups[index.internalId()-1].entries[index.row()].mime;
+    }
+    return out;
+}
+
+QString MimeDefaultsModel::defaultApp(const QModelIndex &index) const {
+    if(!index.isValid() || index.internalId()==0) {
+        return "";
+    }
+    return groups[index.internalId()-1].entries[index.row()].def;
+}
+
+void MimeDefaultsModel::setDefaultApp(const QModelIndex &item, QString app) {
+    if(!item.isValid()) {
+        return;
+    }
+    int group = (item.internalId()==0) ? item.row() : item.internalId()-1;
+    int first = (item.internalId()==0) ? 0 : item.row();
+    int last = (item.internalId()==0) ? groups[group].entries.length()-1 : item.row();
+    for(int i=first; i<=last; i++) {
+        groups[group].entries[i].def = app;
+    }
+    //Only the rows which have been handed to the view need an update
+    last = qMin(last, groups[group].fetched-1);
+    if(first<=last) {
+        QModelIndex parent = createIndex(group, 0, (quintptr) 0);
+        emit dataChanged(index(first, 1, parent), index(last, 1, parent));
+    }
+}
+
+// === Model interface ===
+QModelIndex MimeDefaultsModel::index(int row, int column, const QModelIndex &parent) const {
+    if(column<0 || column>=3 || row<0) {
+        return QModelIndex();
+    }
+    if(!parent.isValid()) {
+        if(row>=groups.length()) {
+            return QModelIndex();
+        }
+        return createIndex(row, column, (quintptr) 0);
+    }
+    if(parent.internalId()!=0 || row>=groups[parent.row()].fetched) {
+        return QModelIndex();    //mimetype rows do not have children
+    }
+    return createIndex(row, column, (quintptr) (parent.row()+1));
+}
+
+QModelIndex MimeDefaultsModel::parent(const QModelIndex &index) const {
+    if(!index.isValid() || index.internalId()==0) {
+        return QModelIndex();
+    }
+    return createIndex(index.internalId()-1, 0, (quintptr) 0);
+}
+
+int MimeDefaultsModel::rowCount(const QModelIndex &parent) const {
+    if(!parent.isValid()) {
+        return groups.length();
+    }
+    if(parent.internalId()!=0 || parent.column()!=0) {
+        return 0;
+    }
+    return groups[parent.row()].fetched;
+}
+
+int MimeDefaultsModel::columnCount(const QModelIndex &) const {
+    return 3;
+}
+
+bool MimeDefaultsModel::hasChildren(const QModelIndex &parent) const {
+    if(!parent.isValid()) {
+        return !groups.isEmpty();
+    }
+    return (parent.internalId()==0 && parent.column()==0 && !groups[parent.row()].entries.isEmpty());
+}
+
+bool MimeDefaultsModel::canFetchMore(const QModelIndex &parent) const {
+    if(!parent.isValid() || parent.internalId()!=0) {
+        return false;
+    }
+    return (groups[parent.row()].fetched < groups[parent.row()].entries.length());
+}
+
+void MimeDefaultsModel::fetchMore(const QModelIndex &parent) {
+    if(!canFetchMore(parent)) {
+        return;
+    }
+    mime_group &group = groups[parent.row()];
+    beginInsertRows(parent, group.fetched, group.entries.length()-1);
+    group.fetched = group.entries.length();
+    endInsertRows();
+}
+
+QVariant MimeDefaultsModel::data(const QModelIndex &index, int role) const {
+    if(!index.isValid()) {
+        return QVariant();
+    }
+    if(index.internalId()==0) {
+        //Group row
+        if(index.column()==0 && role==Qt::DisplayRole) {
+            return groups[index.row()].name; //add translations for known/common groups later
+        }
+        return QVariant();
+    }
+    const mime_entry &entry = groups[index.internalId()-1].entries[index.row()];
+    switch(role) {
+    case Qt::DisplayRole:
+        if(index.column()==0) {
+            return QString(tr("%1 (%2)")).arg(entry.mime.section("/",-1), entry.extlist);
+        }
+        else if(index.column()==1) {
+            return appInfo(entry.def).first;
+        }
+        return entry.comment;
+    case Qt::DecorationRole:
+        if(index.column()==1) {
+            return appInfo(entry.def).second;
+        }
+        break;
+    case Qt::ToolTipRole:
+        if(index.column()<2) {
+            return entry.comment;
+        }
+        break;
+    case Qt::WhatsThisRole:
+        if(index.column()==0) {
+            return entry.mime; // full mimetype
+        }
+        else if(index.column()==1) {
+            return entry.def;
+        }
+        break;
+    }
+    return QVariant();
+}
+
+QVariant MimeDefaultsModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if(orientation!=Qt::Horizontal || role!=Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch(section) {
+    case 0:
+        return tr("Type/Group");
+    case 1:
+        return tr("Default Application");
+    case 2:
+        return tr("Description");
+    }
+    return QVariant();
+}
+
+// === PRIVATE ===
+QPair<QString, QIcon> MimeDefaultsModel::appInfo(QString app) const {
+    if(app.isEmpty()) {
+        return QPair<QString, QIcon>();
+    }
+    if(appinfo.contains(app)) {
+        return appinfo.value(app);
+    }
+    QPair<QString, QIcon> info;
+    if(app.endsWith(".desktop")) {
+        XDGDesktop file(app);
+        if(file.type == XDGDesktop::BAD) {
+            //Might be a binary - just print out the raw "path"
+            info.first = app.section("/",-1);
+            info.second = LXDG::findIcon("application-x-executable","");
+        } else {
+            info.first = file.name;
+            info.second = LXDG::findIcon(file.icon,"");
+        }
+    } else {
+        //Binary/Other default
+        info.first = app.section("/",-1);
+        info.second = LXDG::findIcon("application-x-executable","");
+    }
+    appinfo.insert(app, info);
+    return info;
+}
@@ -0,0 +1,62 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+//  This is the item model for the per-mimetype defaults tree
+//  Groups ("image", "text", ...) are the top-level rows, and the mimetype
+//  rows under a group are only created once that group gets expanded.
+//  The default app name/icon is only looked up when a row is shown.
+//===========================================
+#ifndef _LUMINA_CONFIG_MIME_DEFAULTS_MODEL_H
+#define _LUMINA_CONFIG_MIME_DEFAULTS_MODEL_H
+
+#include "globals.h"
+
+#include <QAbstractItemModel>
+#include <QIcon>
+
+class MimeDefaultsModel : public QAbstractItemModel {
+    Q_OBJECT
+public:
+    MimeDefaultsModel(QObject *parent = 0);
+    ~MimeDefaultsModel();
+
+    //Replace the contents (output format of LXDG::listFileMimeDefaults())
+    void load(QStringList defMimeList);
+
+    //Mimetypes for an index (all the types in a group, or just the one type)
+    QStringList mimeTypes(const QModelIndex &index) const;
+    //Default app for a mimetype row (empty for groups)
+    QString defaultApp(const QModelIndex &index) const;
+    //Change the default for all the types under the index (UI only - does not save)
+    void setDefaultApp(const QModelIndex &item, QString app);
+
+    //Model interface
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    struct mime_entry {
+        QString mime, extlist, def, comment;
+    };
+    struct mime_group {
+        QString name;
+        QList<mime_entry> entries;
+        int fetched; //number of entries visible to the view so far
+    };
+    QList<mime_group> groups;
+    //Display info for the default apps: <app> -> (name, icon)
+    mutable QHash<QString, QPair<QString, QIcon> > appinfo;
+
+    QPair<QString, QIcon> appInfo(QString app) const;
+};
+
+#endif
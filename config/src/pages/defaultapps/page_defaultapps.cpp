@@ -21,7 +21,9 @@ page_defaultapps::page_defaultapps(QWidget *parent) : PageWidget(parent), ui(new
     connect(ui->tool_defaults_clear, SIGNAL(clicked()), this, SLOT(cleardefaultitem()) );
     connect(ui->tool_defaults_set, SIGNAL(clicked()), this, SLOT(setdefaultitem()) );
     connect(ui->tool_defaults_setbin, SIGNAL(clicked()), this, SLOT(setdefaultbinary()) );
-    connect(ui->tree_defaults, SIGNAL(itemSelectionChanged()), this, SLOT(checkdefaulticons()) );
+    mimeModel = new MimeDefaultsModel(this);
+    ui->tree_defaults->setModel(mimeModel);
+    connect(ui->tree_defaults->selectionModel(), SIGNAL(currentChanged(const QModelIndex&, const QModelIndex&)), this, SLOT(checkdefaulticons()) );
     updateIcons();
     ui->tabWidget_apps->setCurrentWidget(ui->tab_auto);
 }
@@ -58,58 +60,8 @@ void page_defaultapps::LoadSettings(int) {
     defaultEmail = LXDG::findDefaultAppForMime("application/email"); //appsettings->value("default/email", "").toString();
     updateDefaultButton(ui->tool_default_email, defaultEmail);
 
-    //Now load the XDG mime defaults
-    ui->tree_defaults->clear();
-    QStringList defMimeList = LXDG::listFileMimeDefaults();
-    //qDebug() << "Mime List:\n" << defMimeList.join("\n");
-    defMimeList.sort(); //sort by group/mime
-    //Now fill the tree by group/mime
-    QTreeWidgetItem *group = 0;
-    QString ccat;
-    for(int i=0; i<defMimeList.length(); i++) {
-        //Get the info from this entry
-        QString mime = defMimeList[i].section("::::",0,0);
-        QString cat = mime.section("/",0,0);
-        QString extlist = defMimeList[i].section("::::",1,1);
-        QString def = defMimeList[i].section("::::",2,2);
-        QString comment = defMimeList[i].section("::::",3,50);
-        //Now check if this is a new category
-        if(group == 0 || ccat!=cat) {
-            //New group
-            group = new QTreeWidgetItem(0);
-            group->setText(0, cat); //add translations for known/common groups later
-            ui->tree_defaults->addTopLevelItem(group);
-            ccat = cat;
-        }
-        //Now create the entry
-        QTreeWidgetItem *it = new QTreeWidgetItem();
-        it->setWhatsThis(0,mime); // full mimetype
-        it->setText(0, QString(tr("%1 (%2)")).arg(mime.section("/",-1), extlist) );
-        it->setText(2,comment);
-        it->setToolTip(0, comment);
-        it->setToolTip(1,comment);
-        //Now load the default (if there is one)
-        it->setWhatsThis(1,def); //save for later
-        it->setData(1, Qt::UserRole, def);
-        if(def.endsWith(".desktop")) {
-            XDGDesktop file(def);
-            if(file.type == XDGDesktop::BAD) {
-                //Might be a binary - just print out the raw "path"
-                it->setText(1, def.section("/",-1));
-                it->setIcon(1, LXDG::findIcon("application-x-executable","") );
-            } else {
-                it->setText(1, file.name);
-                it->setIcon(1, LXDG::findIcon(file.icon,"") );
-            }
-        } else if(!def.isEmpty()) {
-            //Binary/Other default
-            it->setText(1, def.section("/",-1));
-            it->setIcon(1, LXDG::findIcon("application-x-executable","") );
-        }
-        group->addChild(it);
-    }
-
-    ui->tree_defaults->sortItems(0,Qt::AscendingOrder);
+    //Now load the XDG mime defaults (rows and app info get filled in as the groups are expanded)
+    mimeModel->load(LXDG::listFileMimeDefaults());
 
     checkdefaulticons();
 }
@@ -175,8 +127,10 @@ void page_defaultapps::changeDefaultBrowser() {
     }
     //save the new app setting and adjust the button appearance
     defaultBrowser = app;
-    LXDG::setDefaultAppForMime("x-scheme-handler/http", app.section("/",-1));
-    LXDG::setDefaultAppForMime("x-scheme-handler/https", app.section("/",-1));
+    QHash<QString, QString> defaults;
+    defaults.insert("x-scheme-handler/http", app.section("/",-1));
+    defaults.insert("x-scheme-handler/https", app.section("/",-1));
+    LXDG::setDefaultAppForMimes(defaults);
     updateDefaultButton(ui->tool_default_webbrowser, app);
 }
 
@@ -223,75 +177,51 @@ void page_defaultapps::changeDefaultTerminal() {
 }
 
 void page_defaultapps::cleardefaultitem() {
-    QTreeWidgetItem *it = ui->tree_defaults->currentItem();
-    if(it==0) {
+    QModelIndex it = ui->tree_defaults->currentIndex();
+    if(!it.isValid()) {
         return;    //no item selected
     }
-    QList<QTreeWidgetItem*> list;
-    for(int i=0; i<it->childCount(); i++) {
-        list << it->child(i);
-    }
-    if(list.isEmpty()) {
-        list << it;    //just do the current item
-    }
-    //Now clear the items
-    for(int i=0; i<list.length(); i++) {
-        //Clear it in the back end
-        LXDG::setDefaultAppForMime(list[i]->whatsThis(0), "");
-        //Now clear it in the UI
-        list[i]->setWhatsThis(1,""); //clear the app path
-        list[i]->setIcon(1,QIcon()); //clear the icon
-        list[i]->setText(1,""); //clear the name
+    it = it.siblingAtColumn(0);
+    //Clear it in the back end (all the types in a group at once)
+    QStringList mimes = mimeModel->mimeTypes(it);
+    QHash<QString, QString> defaults;
+    for(int i=0; i<mimes.length(); i++) {
+        defaults.insert(mimes[i], "");
     }
-
+    LXDG::setDefaultAppForMimes(defaults);
+    //Now clear it in the UI
+    mimeModel->setDefaultApp(it, "");
 }
 
 void page_defaultapps::setdefaultitem() {
-    QTreeWidgetItem *it = ui->tree_defaults->currentItem();
-    QString path;
-    if(it==0) {
+    QModelIndex it = ui->tree_defaults->currentIndex();
+    if(!it.isValid()) {
         return;    //no item selected
     }
-    QList<QTreeWidgetItem*> list;
-    for(int i=0; i<it->childCount(); i++) {
-        list << it->child(i);
-    }
-    if(list.isEmpty()) {
-        //just do the current item
-        list << it;
-        path = it->data(1, Qt::UserRole).toString();
-    }
+    it = it.siblingAtColumn(0);
+    QString path = mimeModel->defaultApp(it); //empty for groups
     //Prompt for which application to use
     QString app = getSysApp(false, path); //no "reset"  option
     if(app.isEmpty()) {
         return;    //nothing selected
     }
-    //Now set the items
-    for(int i=0; i<list.length(); i++) {
-        //Set it in the back end
-        LXDG::setDefaultAppForMime(list[i]->whatsThis(0), app);
-        //Set it in the UI
-        XDGDesktop desk(app);
-        list[i]->setWhatsThis(1,app); //app path
-        list[i]->setIcon(1,LXDG::findIcon(desk.icon,"")); //reset the icon
-        list[i]->setText(1,desk.name); //reset the name
-        list[i]->setData(1, Qt::UserRole, app);
+    //Set it in the back end (all the types in a group at once)
+    QStringList mimes = mimeModel->mimeTypes(it);
+    QHash<QString, QString> defaults;
+    for(int i=0; i<mimes.length(); i++) {
+        defaults.insert(mimes[i], app);
     }
-
+    LXDG::setDefaultAppForMimes(defaults);
+    //Set it in the UI
+    mimeModel->setDefaultApp(it, app);
 }
 
 void page_defaultapps::setdefaultbinary() {
-    QTreeWidgetItem *it = ui->tree_defaults->currentItem();
-    if(it==0) {
+    QModelIndex it = ui->tree_defaults->currentIndex();
+    if(!it.isValid()) {
         return;    //no item selected
     }
-    QList<QTreeWidgetItem*> list;
-    for(int i=0; i<it->childCount(); i++) {
-        list << it->child(i);
-    }
-    if(list.isEmpty()) {
-        list << it;    //just do the current item
-    }
+    it = it.siblingAtColumn(0);
     //Prompt for which binary to use
     QFileDialog dlg(this);
     //dlg.setFilter(QDir::Executable | QDir::Files); //Does not work! Filters executable files as well as breaks browsing capabilities
@@ -307,20 +237,20 @@ void page_defaultapps::setdefaultbinary() {
         QMessageBox::warning(this, tr("Invalid Binary"), tr("The selected binary is not executable!"));
         return;
     }
-    //Now set the items
-    for(int i=0; i<list.length(); i++) {
-        //Set it in the back end
-        LXDG::setDefaultAppForMime(list[i]->whatsThis(0), path);
-        //Set it in the UI
-        list[i]->setWhatsThis(1,path); //app path
-        list[i]->setIcon(1,LXDG::findIcon("application-x-executable","")); //clear the icon
-        list[i]->setText(1,path.section("/",-1)); //clear the name
+    //Set it in the back end (all the types in a group at once)
+    QStringList mimes = mimeModel->mimeTypes(it);
+    QHash<QString, QString> defaults;
+    for(int i=0; i<mimes.length(); i++) {
+        defaults.insert(mimes[i], path);
     }
+    LXDG::setDefaultAppForMimes(defaults);
+    //Set it in the UI
+    mimeModel->setDefaultApp(it, path);
 }
 
 void page_defaultapps::checkdefaulticons() {
-    QTreeWidgetItem *it = ui->tree_defaults->currentItem();
-    ui->tool_defaults_set->setEnabled(it!=0);
-    ui->tool_defaults_clear->setEnabled(it!=0);
-    ui->tool_defaults_setbin->setEnabled(it!=0);
+    bool ok = ui->tree_defaults->currentIndex().isValid();
+    ui->tool_defaults_set->setEnabled(ok);
+    ui->tool_defaults_clear->setEnabled(ok);
+    ui->tool_defaults_setbin->setEnabled(ok);
 }
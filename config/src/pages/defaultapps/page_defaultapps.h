@@ -8,6 +8,7 @@
 #define _LUMINA_CONFIG_PAGE_DEFAULTAPPS_H
 #include "globals.h"
 #include "../PageWidget.h"
+#include "MimeDefaultsModel.h"
 
 namespace Ui {
 class page_defaultapps;
@@ -30,6 +31,7 @@ private:
     QString defaultEmail;
     QString defaultFileManager;
     QString defaultTerminal;
+    MimeDefaultsModel *mimeModel;
 
     QString getSysApp(bool allowreset, QString defaultPath = "");
 
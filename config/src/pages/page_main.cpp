@@ -22,7 +22,7 @@ page_main::page_main(QWidget *parent) : PageWidget(parent), ui(new Ui::page_main
     connect(ui->treeWidget, SIGNAL(itemPressed(QTreeWidgetItem*,int)), this, SLOT(itemTriggered(QTreeWidgetItem*, int)) );
 
     connect(ui->lineEdit, SIGNAL(textChanged(QString)), this, SLOT(searchChanged(QString)) );
-    connect(APPSLIST, SIGNAL(appsUpdated()), this, SLOT(LoadSettings()) );
+    connect(APPSLIST, SIGNAL(appsUpdated(QStringList, QStringList, QStringList)), this, SLOT(LoadSettings()) );
 }
 
 page_main::~page_main() {
@@ -206,7 +206,7 @@ void page_main::LoadSettings(int) {
     QList<XDGDesktop*> apps = APPSLIST->apps(false,false); //only valid, non-hidden files
     qDebug() << "Found Apps:" << apps.length();
     for(int i=0; i<apps.length(); i++) {
-        if( !apps[i]->catList.contains("Settings") || apps[i]->filePath.endsWith("7b7b-config.desktop") ) {
+        if( !(apps[i]->categoryMask() & (1<<XDGDesktop::CAT_SETTINGS)) || apps[i]->filePath.endsWith("7b7b-config.desktop") ) {
             continue;
         }
         INFO << Pages::PageInfo(apps[i]->filePath, apps[i]->name, apps[i]->genericName, apps[i]->icon, apps[i]->comment, "system", QStringList(), apps[i]->keyList);
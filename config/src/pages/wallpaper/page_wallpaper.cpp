@@ -7,6 +7,9 @@
 #include "page_wallpaper.h"
 #include "ui_page_wallpaper.h"
 
+#include <LThumbnailer.h>
+#include <QtMath>
+
 //==========
 //    PUBLIC
 //==========
@@ -15,6 +18,7 @@ page_wallpaper::page_wallpaper(QWidget *parent) : PageWidget(parent), ui(new Ui:
     DEFAULTBG = LOS::LuminaShare()+"/desktop-background.jpg";
     updateIcons();
     connect(ui->combo_desk_bg, SIGNAL(currentIndexChanged(int)), this, SLOT(deskbgchanged()) );
+    connect(LThumbnailer::instance(), SIGNAL(ThumbnailReady(QString, QImage)), this, SLOT(thumbnailReady(QString, QImage)) );
     connect(ui->radio_desk_multi, SIGNAL(toggled(bool)), this, SLOT(desktimechanged()) );
     connect(ui->tool_desk_addbg, SIGNAL(clicked()), this, SLOT(deskbgadded()) );
     connect(ui->tool_desk_rmbg, SIGNAL(clicked()), this, SLOT(deskbgremoved()) );
@@ -70,9 +74,9 @@ void page_wallpaper::LoadSettings(int screennum) {
         else if(bgs[i].startsWith("rgb(")) {
             ui->combo_desk_bg->addItem(QString(tr("Solid Color: %1")).arg(bgs[i]), bgs[i]);
         }
-        //else{ ui->combo_desk_bg->addItem( QIcon(QPixmap(bgs[i]).scaled(64,64)), bgs[i].section("/",-1), bgs[i] ); }
         else {
-            ui->combo_desk_bg->addItem( bgs[i].section("/",-1), bgs[i] );    //disable the thumbnail - takes a long time for large collections of files
+            ui->combo_desk_bg->addItem( bgs[i].section("/",-1), bgs[i] );
+            requestThumbnail(bgs[i]); //icon gets added once available
         }
     }
 
@@ -103,6 +107,12 @@ void page_wallpaper::updateIcons() {
 //=================
 //        PRIVATE
 //=================
+void page_wallpaper::requestThumbnail(QString path) {
+    if(QFileInfo(path).isFile()) {
+        LThumbnailer::instance()->requestThumbnail(path, qCeil(ui->combo_desk_bg->iconSize().height()*ui->combo_desk_bg->devicePixelRatioF()));
+    }
+}
+
 QString page_wallpaper::getColorStyle(QString current, bool allowTransparency) {
     QString out;
     //Convert the current color string into a QColor
@@ -158,6 +168,15 @@ void page_wallpaper::updateMenus() {
 
 }
 
+void page_wallpaper::thumbnailReady(QString file, QImage img) {
+    QIcon ico(QPixmap::fromImage(img));
+    for(int i=0; i<ui->combo_desk_bg->count(); i++) {
+        if(ui->combo_desk_bg->itemData(i).toString()==file) {
+            ui->combo_desk_bg->setItemIcon(i, ico);
+        }
+    }
+}
+
 void page_wallpaper::deskbgchanged() {
     //Load the new image preview
     bool allow_time_set = true;
@@ -259,7 +278,8 @@ void page_wallpaper::deskbgadded() {
         return;
     }
     for(int i=0; i<bgs.length(); i++) {
-        ui->combo_desk_bg->addItem( QIcon(bgs[i]), bgs[i].section("/",-1), bgs[i]);
+        ui->combo_desk_bg->addItem( bgs[i].section("/",-1), bgs[i]);
+        requestThumbnail(bgs[i]);
     }
     //Now move to the last item in the list (the new image(s));
     ui->combo_desk_bg->setCurrentIndex( ui->combo_desk_bg->count()-1 );
@@ -35,9 +35,11 @@ private:
     bool loading;
 
     QString getColorStyle(QString current, bool allowTransparency);
+    void requestThumbnail(QString path); //combo box icon for an image (loaded in the background)
 
 private slots:
     void updateMenus();
+    void thumbnailReady(QString file, QImage img);
     void deskbgchanged();
     void desktimechanged();
     void deskbgremoved();
@@ -66,17 +66,18 @@ LPI LPlugins::menuPluginInfo(QString plug) {
 void LPlugins::LoadPanelPlugins() {
     PANEL.clear();
     QStringList nameList = QStringList() << QObject::tr("Application Menu") << QObject::tr("Task Manager") << QObject::tr("Spacer")
-    << QObject::tr("System Tray") << QObject::tr("Time/Date") << QObject::tr("Show Desktop");
+    << QObject::tr("System Tray") << QObject::tr("Time/Date") << QObject::tr("Show Desktop") << QObject::tr("Application Search");
 
 	QStringList descriptionList = QStringList() << QObject::tr("Start menu alternative which focuses on launching applications.")
 	<< QObject::tr("View and control any running application windows (group similar windows under a single button).")
 	<< QObject::tr("Invisible spacer to separate plugins.") << QObject::tr("Display area for dockable system applications")
-	<< QObject::tr("View the current time and date.") << QObject::tr("Hide all open windows and show the desktop");
+	<< QObject::tr("View the current time and date.") << QObject::tr("Hide all open windows and show the desktop")
+	<< QObject::tr("Type to search for and launch applications.");
 
-	QStringList IDList = QStringList() << "appmenu" << "taskmanager" << "spacer" << "systemtray" << "clock" << "homebutton";
+	QStringList IDList = QStringList() << "appmenu" << "taskmanager" << "spacer" << "systemtray" << "clock" << "homebutton" << "appsearch";
 
 	QStringList iconList = QStringList() << "format-list-unordered" << "preferences-system-windows" << "transform-move" << "preferences-system-windows-actions"
-	<< "preferences-system-time" << "user-desktop";
+	<< "preferences-system-time" << "user-desktop" << "system-search";
 
 	LPI info;
 	for (int i = 0; i < nameList.length(); i++){
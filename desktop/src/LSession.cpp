@@ -20,6 +20,7 @@
 #include <LUtils.h>
 #include <ExternalProcess.h>
 #include <LIconCache.h>
+#include <LIconSharedCache.h>
 
 #include <unistd.h> //for usleep() usage
 #define DEBUG 0
@@ -48,6 +49,7 @@ LSession::LSession(int &argc, char ** argv) : LSingleApplication(argc, argv, "7b
         cleansession = true;
         TrayStopping = false;
         xchange = false;
+        LIconSharedCache::instance()->openWriter(); //this process fills the icon cache for all the others
         ICONS = new LIconCache(this);
         screenTimer = new QTimer(this);
         screenTimer->setSingleShot(true);
@@ -125,6 +127,9 @@ void LSession::setupSession() {
 
     //Initialize the global menus
     qDebug() << " - Initialize system menus";
+    XDGDesktopList::setParseThreads( sessionsettings->value("AppParseThreads",0).toInt() );
+    XDGDesktop::setLocaleBudget( sessionsettings->value("AppLocaleCacheKB",4096).toLongLong()*1024 );
+    ICONS->setMemoryBudget( sessionsettings->value("IconCacheKB",32768).toLongLong()*1024 );
 
     appmenu = new AppMenu();
 
@@ -242,6 +247,11 @@ void LSession::NewCommunication(QStringList list) {
             emit StartButtonActivated();
         } else if(list[i]=="--logout") {
             QTimer::singleShot(1000, this, SLOT(StartLogout()));
+        } else if(list[i]=="--icon-stats") {
+            //Icon cache counters in the session log (for sizing IconCacheKB on this machine)
+            icon_cache_stats stats = ICONS->stats();
+            qDebug() << "Icon Cache:" << "Entries:" << stats.entries << "Memory:" << stats.bytes/1024 << "KB of" << stats.budget/1024 << "KB"
+                     << "Hits:" << stats.hits << "Misses:" << stats.misses << "Evictions:" << stats.evictions << "Cancelled:" << stats.cancelled;
         }
     }
 }
@@ -644,6 +654,16 @@ WId LSession::activeWindow() {
     return lastActiveWin;
 }
 
+void LSession::switchLocale(QString localeCode) {
+    //Temporarily change the session locale (nothing saved between sessions)
+    if(localeCode.isEmpty() || localeCode==QLocale().name()) {
+        return;
+    }
+    qputenv("LANG", localeCode.toUtf8());
+    QLocale::setDefault( QLocale(localeCode) );
+    emit LocaleChanged(); //the app menu re-labels its entries in memory
+}
+
 void LSession::systemWindow() {
     if(sysWindow==0) {
         sysWindow = new SystemWindow();
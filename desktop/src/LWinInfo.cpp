@@ -45,6 +45,13 @@ QIcon LWinInfo::icon(bool &noicon) {
     noicon = false;
     QIcon ico = LSession::handle()->XCB->WindowIcon(window);
     //Check for a null icon, and supply one if necessary
+    if(ico.isNull()) {
+        //Use the icon from the matching application entry if there is one
+        XDGDesktop *desk = this->app();
+        if(desk!=0 && !desk->icon.isEmpty()) {
+            ico = LXDG::findIcon(desk->icon, "");
+        }
+    }
     if(ico.isNull()) {
         QString cls = this->Class();
         ico = LXDG::findIcon( cls, cls.toLower());
@@ -60,6 +67,13 @@ QString LWinInfo::Class() {
     return LSession::handle()->XCB->WindowClass(window);
 }
 
+XDGDesktop* LWinInfo::app() {
+    if(window==0) {
+        return 0;
+    }
+    return LSession::handle()->applicationMenu()->appList()->findAppForWindowClass( this->Class() );
+}
+
 LXCB::WINDOWVISIBILITY LWinInfo::status(bool update) {
     if(window==0) {
         return LXCB::IGNORE;
@@ -43,6 +43,7 @@ public:
     QString  text();
     QIcon icon(bool &noicon);
     QString Class();
+    XDGDesktop* app(); //application entry for this window (if any)
     LXCB::WINDOWVISIBILITY status(bool update = false);
 };
 
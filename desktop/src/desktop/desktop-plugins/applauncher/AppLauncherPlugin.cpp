@@ -4,12 +4,15 @@
 #include <QClipboard>
 
 #include <LIconCache.h>
+#include <LThumbnailer.h>
+#include <QtMath>
 
 #define OUTMARGIN 10 //special margin for fonts due to the outlining effect from the OutlineToolbutton
 extern LIconCache *ICONS;
 
 AppLauncherPlugin::AppLauncherPlugin(QWidget* parent, QString ID) : LDPlugin(parent, ID) {
     connect(ICONS, SIGNAL(IconAvailable(QString)), this, SLOT(iconLoaded(QString)) );
+    connect(LThumbnailer::instance(), SIGNAL(ThumbnailReady(QString, QImage)), this, SLOT(thumbnailReady(QString, QImage)) );
     QVBoxLayout *lay = new QVBoxLayout();
     inputDLG = 0;
     this->setLayout(lay);
@@ -120,14 +123,25 @@ void AppLauncherPlugin::loadButton() {
             else {
                 iconame = "folder";    //button->setIcon( LXDG::findIcon("folder","") );
             }
-        } else if(LUtils::imageExtensions().contains(info.suffix().toLower()) ) {
-            iconame = info.absoluteFilePath();
-            //QPixmap pix;
-            //if(pix.load(path)){ button->setIcon( QIcon(pix.scaled(256,256)) ); } //max size for thumbnails in memory
-            //else{ iconame = "dialog-cancel"; } //button->setIcon( LXDG::findIcon("dialog-cancel","") );
         } else {
-            iconame = LXDG::findAppMimeForFile(path).replace("/","-");
-            //button->setIcon( QIcon(LXDG::findMimeIcon(path).pixmap(QSize(icosize,icosize)).scaledToHeight(icosize, Qt::SmoothTransformation) ) );
+            XDGFileType type = LXDG::classifyFile(info.absoluteFilePath());
+            if(type.isImage) {
+                //Use the shared thumbnail instead of the image itself (file type icon until it has been made)
+                int thumbsize = qCeil(icosize*button->devicePixelRatioF());
+                iconame = LThumbnailer::cachedThumbnail(type.path, thumbsize);
+                if(iconame.isEmpty()) {
+                    LThumbnailer::instance()->requestThumbnail(type.path, thumbsize);
+                }
+            }
+            if(iconame.isEmpty()) {
+                //No thumbnail (yet) - use the file type icon
+                if(!ICONS->exists(type.icon) && ICONS->exists(type.genericIcon)) {
+                    iconame = type.genericIcon;
+                } else {
+                    iconame = type.icon;
+                    //button->setIcon( QIcon(LXDG::findMimeIcon(path).pixmap(QSize(icosize,icosize)).scaledToHeight(icosize, Qt::SmoothTransformation) ) );
+                }
+            }
         }
         if(!iconame.isEmpty()) {
             iconID = iconame;
@@ -270,8 +284,8 @@ void AppLauncherPlugin::buttonClicked(bool openwith) {
 
 void AppLauncherPlugin::iconLoaded(QString ico) {
     if(ico == iconID) {
-        //Reload/scale the icon as needed
-        QPixmap pix = button->icon().pixmap(QSize(icosize,icosize)).scaledToHeight(icosize, Qt::SmoothTransformation);
+        //The cache already loaded the icon at the button size
+        QPixmap pix = button->icon().pixmap(QSize(icosize,icosize), button->devicePixelRatioF());
         if(QFileInfo(button->whatsThis()).isSymLink()) {
             QImage img = pix.toImage();
             int oSize = icosize/3; //overlay size
@@ -284,6 +298,15 @@ void AppLauncherPlugin::iconLoaded(QString ico) {
     }
 }
 
+void AppLauncherPlugin::thumbnailReady(QString file, QImage img) {
+    if(file != button->whatsThis()) {
+        return;
+    }
+    iconID = file;
+    button->setIcon( QIcon(QPixmap::fromImage(img)) );
+    iconLoaded(iconID); //add the link overlay if needed
+}
+
 void AppLauncherPlugin::startDragNDrop() {
     //Start the drag event for this file
     QDrag *drag = new QDrag(this);
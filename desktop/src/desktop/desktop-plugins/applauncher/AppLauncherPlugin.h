@@ -47,6 +47,7 @@ private slots:
     void loadButton();
     void buttonClicked(bool openwith = false);
     void iconLoaded(QString);
+    void thumbnailReady(QString file, QImage img);
 
     //void openContextMenu();
 
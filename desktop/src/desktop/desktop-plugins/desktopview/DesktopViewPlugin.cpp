@@ -5,8 +5,11 @@
 #include <QClipboard>
 #include <QMimeData>
 #include <QImageReader>
+#include <QPainter>
+#include <QtMath>
 
 #include <LuminaXDG.h>
+#include <LThumbnailer.h>
 #include "LSession.h"
 
 
@@ -14,6 +17,8 @@ DesktopViewPlugin::DesktopViewPlugin(QWidget* parent, QString ID) : LDPlugin(par
     this->setLayout( new QVBoxLayout());
     this->layout()->setContentsMargins(0,0,0,0);
 
+    classifier = 0;
+    connect(LThumbnailer::instance(), SIGNAL(ThumbnailReady(QString, QImage)), this, SLOT(thumbnailReady(QString, QImage)) );
     list = new QListWidget(this);
     list->setViewMode(QListView::IconMode);
     list->setFlow(QListWidget::TopToBottom); //Qt bug workaround - need the opposite flow in the widget constructor
@@ -135,6 +140,15 @@ void DesktopViewPlugin::decreaseIconSize() {
 }
 
 void DesktopViewPlugin::updateContents() {
+    //Drop any icons still being looked up for the old items
+    if(classifier!=0) {
+        classifier->disconnect(this);
+        classifier->cancel();
+        classifier->deleteLater();
+        classifier = 0;
+    }
+    pendingItems.clear();
+    thumbItems.clear();
     list->clear();
 
     int icosize = this->readSetting("IconSize",64).toInt();
@@ -144,45 +158,35 @@ void DesktopViewPlugin::updateContents() {
     list->setIconSize(QSize(icosize,icosize));
     QDir dir(QDir::homePath()+"/Desktop");
     QFileInfoList files = dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::Type | QDir::DirsFirst);
+    QStringList classify;
     for(int i=0; i<files.length(); i++) {
         QListWidgetItem *it = new QListWidgetItem;
         it->setSizeHint(gridSZ); //ensure uniform item sizes
         //it->setForeground(QBrush(Qt::black, Qt::Dense2Pattern)); //Try to use a font color which will always be visible
         it->setTextAlignment(Qt::AlignCenter);
         it->setWhatsThis(files[i].absoluteFilePath());
-        QString txt;
+        QString txt = files[i].fileName();
+        bool typed = false; //icon already known
         if(files[i].isDir()) {
             it->setIcon( LXDG::findIcon("folder","") );
-            txt = files[i].fileName();
+            typed = true;
         } else if(files[i].suffix() == "desktop" ) {
             XDGDesktop desk(files[i].absoluteFilePath());
             if(desk.isValid()) {
                 it->setIcon( LXDG::findIcon(desk.icon,"unknown") );
-                if(desk.name.isEmpty()) {
-                    txt = files[i].fileName();
-                } else {
+                if(!desk.name.isEmpty()) {
                     txt = desk.name;
                 }
-            } else {
-                //Revert back to a standard file handling
-                it->setIcon( LXDG::findMimeIcon(files[i].fileName()) );
-                txt = files[i].fileName();
+                typed = true;
             }
-        } else if(LUtils::imageExtensions().contains(files[i].suffix().toLower()) ) {
-            it->setIcon( QIcon( QPixmap(files[i].absoluteFilePath()).scaled(icosize,icosize,Qt::IgnoreAspectRatio, Qt::SmoothTransformation) ) );
-            txt = files[i].fileName();
-        } else {
-            it->setIcon( LXDG::findMimeIcon( files[i].fileName() ) );
-            txt = files[i].fileName();
+            //Otherwise revert back to a standard file handling
         }
-        //Add the sym-link overlay to the icon as necessary
-        if(files[i].isSymLink()) {
-            QImage img = it->icon().pixmap(QSize(icosize,icosize)).toImage();
-            int oSize = icosize/2; //overlay size
-            QPixmap overlay = LXDG::findIcon("emblem-symbolic-link").pixmap(oSize,oSize).scaled(oSize,oSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-            QPainter painter(&img);
-            painter.drawPixmap(icosize-oSize,icosize-oSize,overlay); //put it in the bottom-right corner
-            it->setIcon( QIcon(QPixmap::fromImage(img)) );
+        if(!typed) {
+            //Mimetype/thumbnail gets filled in once the file has been classified in the background
+            classify << files[i].absoluteFilePath();
+            pendingItems << it;
+        } else if(files[i].isSymLink()) {
+            addLinkOverlay(it, icosize);
         }
         //Now adjust the visible text as necessary based on font/grid sizing
         it->setToolTip(txt);
@@ -216,6 +220,65 @@ void DesktopViewPlugin::updateContents() {
     }
     list->setFlow(QListWidget::TopToBottom); //To ensure this is consistent - issues with putting it in the constructor
     list->update(); //Re-paint the widget after all items are added
+    if(!classify.isEmpty()) {
+        classifier = new QFutureWatcher<XDGFileType>(this);
+        connect(classifier, SIGNAL(resultsReadyAt(int,int)), this, SLOT(fileTypesReady(int,int)) );
+        classifier->setFuture( LXDG::classifyFilesAsync(classify) );
+    }
+}
+
+void DesktopViewPlugin::fileTypesReady(int first, int last) {
+    if(classifier==0 || sender()!=classifier) {
+        return;    //results for an old listing
+    }
+    int icosize = list->iconSize().width();
+    for(int i=first; i<last && i<pendingItems.length(); i++) {
+        XDGFileType type = classifier->resultAt(i);
+        QListWidgetItem *it = pendingItems[i];
+        if(type.isImage) {
+            //File type icon until the thumbnail is available
+            thumbItems.insert(type.path, it);
+            LThumbnailer::instance()->requestThumbnail(type.path, qCeil(icosize*this->devicePixelRatioF()));
+        }
+        QIcon ico = LXDG::findIcon(type.icon, type.genericIcon);
+        if(ico.isNull()) {
+            ico = LXDG::findIcon("unknown","");
+        }
+        it->setIcon(ico);
+        if(type.isSymLink) {
+            addLinkOverlay(it, icosize);
+        }
+    }
+}
+
+void DesktopViewPlugin::thumbnailReady(QString file, QImage img) {
+    QListWidgetItem *it = thumbItems.take(file);
+    if(it==0) {
+        return;    //not one of ours (or the listing changed since)
+    }
+    //Center it on a square the size of the icons
+    int icosize = list->iconSize().width();
+    qreal dpr = this->devicePixelRatioF();
+    QImage square(qCeil(icosize*dpr), qCeil(icosize*dpr), QImage::Format_ARGB32_Premultiplied);
+    square.fill(Qt::transparent);
+    img = img.scaled(square.size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QPainter painter(&square);
+    painter.drawImage((square.width()-img.width())/2, (square.height()-img.height())/2, img);
+    painter.end();
+    square.setDevicePixelRatio(dpr);
+    it->setIcon( QIcon(QPixmap::fromImage(square)) );
+    if(QFileInfo(file).isSymLink()) {
+        addLinkOverlay(it, icosize);
+    }
+}
+
+void DesktopViewPlugin::addLinkOverlay(QListWidgetItem *it, int icosize) {
+    QImage img = it->icon().pixmap(QSize(icosize,icosize)).toImage();
+    int oSize = icosize/2; //overlay size
+    QPixmap overlay = LXDG::findIcon("emblem-symbolic-link").pixmap(oSize,oSize).scaled(oSize,oSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QPainter painter(&img);
+    painter.drawPixmap(icosize-oSize,icosize-oSize,overlay); //put it in the bottom-right corner
+    it->setIcon( QIcon(QPixmap::fromImage(img)) );
 }
 
 void DesktopViewPlugin::displayProperties() {
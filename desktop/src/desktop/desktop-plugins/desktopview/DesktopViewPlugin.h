@@ -14,6 +14,9 @@
 #include <QTimer>
 #include <QFileSystemWatcher>
 #include <QMouseEvent>
+#include <QFutureWatcher>
+
+#include <LuminaXDG.h>
 
 #include "../LDPlugin.h"
 
@@ -30,6 +33,11 @@ public:
 private:
     QListWidget *list;
     QMenu *menu;
+    QFutureWatcher<XDGFileType> *classifier; //background mimetype lookups for the current items
+    QList<QListWidgetItem*> pendingItems; //items waiting on those results (same order)
+    QHash<QString, QListWidgetItem*> thumbItems; //image items waiting on a thumbnail: <file> -> item
+
+    void addLinkOverlay(QListWidgetItem *it, int icosize);
 
 private slots:
     void runItems();
@@ -40,6 +48,8 @@ private slots:
     void increaseIconSize();
     void decreaseIconSize();
     void updateContents();
+    void fileTypesReady(int first, int last);
+    void thumbnailReady(QString file, QImage img);
     void displayProperties();
 
 
@@ -18,6 +18,7 @@
 #include "taskmanager/LTaskManagerPlugin.h"
 #include "showdesktop/LHomeButton.h"
 #include "appmenu/LAppMenuPlugin.h"
+#include "appsearch/LAppSearchPlugin.h"
 #include "systemtray/LSysTray.h" //must be last due to X11 compile issues
 
 
@@ -27,6 +28,8 @@ public:
         LPPlugin *plug = 0;
         if(plugin.startsWith("appmenu---")) {
             plug = new LAppMenuPlugin(parent, plugin, horizontal);
+        } else if(plugin.startsWith("appsearch---")) {
+            plug = new LAppSearchPlugin(parent, plugin, horizontal);
         } else if(plugin.startsWith("taskmanager")) {
             plug = new LTaskManagerPlugin(parent, plugin, horizontal);
         } else if(plugin.startsWith("spacer---")) {
@@ -0,0 +1,120 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LAppSearchPlugin.h"
+#include "LSession.h"
+
+#include <QKeyEvent>
+#include <QScreen>
+#include <QVBoxLayout>
+
+#include <LuminaXDG.h>
+#include <LIconCache.h>
+
+extern LIconCache *ICONS;
+
+#define MAX_RESULTS 12
+
+LAppSearchPlugin::LAppSearchPlugin(QWidget *parent, QString id, bool horizontal) : LPPlugin(parent, id, horizontal) {
+    button = new QToolButton(this);
+    button->setAutoRaise(true);
+    button->setToolButtonStyle(Qt::ToolButtonIconOnly);
+    this->layout()->setContentsMargins(0,0,0,0);
+    this->layout()->addWidget(button);
+    //Popup with the search field and results
+    popup = new QWidget(this, Qt::Popup);
+    QVBoxLayout *lay = new QVBoxLayout(popup);
+    lay->setContentsMargins(2,2,2,2);
+    searchLine = new QLineEdit(popup);
+    searchLine->setClearButtonEnabled(true);
+    results = new QListWidget(popup);
+    results->setFocusPolicy(Qt::NoFocus); //keep typing in the search field
+    lay->addWidget(searchLine);
+    lay->addWidget(results);
+    popup->resize(300, 360);
+    searchLine->installEventFilter(this);
+    popup->installEventFilter(this); //however it gets closed (launch, Escape, click outside)
+
+    connect(button, SIGNAL(clicked()), this, SLOT(showPopup()) );
+    connect(searchLine, SIGNAL(textChanged(const QString&)), this, SLOT(updateResults()) );
+    connect(searchLine, SIGNAL(returnPressed()), this, SLOT(launchCurrent()) );
+    connect(results, SIGNAL(itemClicked(QListWidgetItem*)), this, SLOT(launchItem(QListWidgetItem*)) );
+    QTimer::singleShot(0,this, SLOT(OrientationChange())); //Update icons/sizes
+}
+
+LAppSearchPlugin::~LAppSearchPlugin() {
+
+}
+
+void LAppSearchPlugin::updateButtonVisuals() {
+    button->setToolTip( tr("Search for applications") );
+    button->setIcon( LXDG::findIcon("system-search", "") );
+    searchLine->setPlaceholderText( tr("Type to search...") );
+}
+
+bool LAppSearchPlugin::eventFilter(QObject *obj, QEvent *ev) {
+    if(obj==popup && ev->type()==QEvent::Hide) {
+        emit MenuClosed();
+        return false;
+    }
+    //Up/Down in the search field move through the results
+    if(obj==searchLine && ev->type()==QEvent::KeyPress) {
+        int key = static_cast<QKeyEvent*>(ev)->key();
+        if( (key==Qt::Key_Down || key==Qt::Key_Up) && results->count()>0 ) {
+            int row = results->currentRow() + (key==Qt::Key_Down ? 1 : -1);
+            results->setCurrentRow( qBound(0, row, results->count()-1) );
+            return true;
+        }
+    }
+    return LPPlugin::eventFilter(obj, ev);
+}
+
+// ========================
+//    PRIVATE FUNCTIONS
+// ========================
+void LAppSearchPlugin::showPopup() {
+    searchLine->clear();
+    results->clear();
+    //Place the popup next to the button (on screen)
+    QPoint pos = button->mapToGlobal( QPoint(0, button->height()) );
+    QRect screen = button->screen()->availableGeometry();
+    if(pos.y()+popup->height() > screen.bottom()) {
+        pos.setY( button->mapToGlobal(QPoint(0,0)).y() - popup->height() );
+    }
+    if(pos.x()+popup->width() > screen.right()) {
+        pos.setX( screen.right() - popup->width() );
+    }
+    popup->move(pos);
+    popup->show();
+    popup->activateWindow();
+    searchLine->setFocus();
+}
+
+void LAppSearchPlugin::updateResults() {
+    results->clear();
+    //Each keystroke refines the previous query within the search index
+    QList<XDGDesktop*> apps = LSession::handle()->applicationMenu()->appList()->search(searchLine->text(), MAX_RESULTS);
+    for(int i=0; i<apps.length(); i++) {
+        QListWidgetItem *it = new QListWidgetItem(ICONS->loadIcon(apps[i]->icon), apps[i]->name, results);
+        it->setToolTip(apps[i]->comment);
+        it->setWhatsThis(apps[i]->filePath);
+    }
+    if(results->count()>0) {
+        results->setCurrentRow(0);
+    }
+}
+
+void LAppSearchPlugin::launchCurrent() {
+    launchItem(results->currentItem());
+}
+
+void LAppSearchPlugin::launchItem(QListWidgetItem *item) {
+    if(item==0) {
+        return;
+    }
+    QString appFile = item->whatsThis();
+    popup->hide(); //emits MenuClosed()
+    LSession::LaunchApplication("7b7b-open "+appFile);
+}
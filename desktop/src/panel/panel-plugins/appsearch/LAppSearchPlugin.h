@@ -0,0 +1,66 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+//  This panel plugin is a type-to-launch application search
+//===========================================
+#ifndef _LUMINA_DESKTOP_APP_SEARCH_PANEL_PLUGIN_H
+#define _LUMINA_DESKTOP_APP_SEARCH_PANEL_PLUGIN_H
+
+// Qt includes
+#include <QToolButton>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QString>
+#include <QWidget>
+
+// Lumina-desktop includes
+#include "../LPPlugin.h" //main plugin widget
+
+// PANEL PLUGIN BUTTON
+class LAppSearchPlugin : public LPPlugin {
+    Q_OBJECT
+
+public:
+    explicit LAppSearchPlugin(QWidget *parent = 0, QString id = "appsearch", bool horizontal=true);
+    ~LAppSearchPlugin();
+
+private:
+    QToolButton *button;
+    QWidget *popup;
+    QLineEdit *searchLine;
+    QListWidget *results;
+
+    void updateButtonVisuals();
+    bool eventFilter(QObject *obj, QEvent *ev) override;
+
+private slots:
+    void showPopup();
+    void updateResults();
+    void launchCurrent();
+    void launchItem(QListWidgetItem *item);
+
+public slots:
+    void OrientationChange() override {
+        if(this->layout()->direction()==QBoxLayout::LeftToRight) {
+            this->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::MinimumExpanding);
+            button->setIconSize( QSize(this->height(), this->height()) );
+        } else {
+            this->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
+            button->setIconSize( QSize(this->width(), this->width()) );
+        }
+        this->layout()->update();
+        updateButtonVisuals();
+    }
+
+    void LocaleChange() override {
+        updateButtonVisuals();
+    }
+
+    void ThemeChange() override {
+        updateButtonVisuals();
+    }
+};
+
+#endif
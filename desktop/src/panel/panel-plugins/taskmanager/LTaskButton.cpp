@@ -25,6 +25,7 @@ LTaskButton::LTaskButton(QWidget *parent) : LTBWidget(parent) {
     connect(winMenu, SIGNAL(triggered(QAction*)), this, SLOT(winClicked(QAction*)) );
     connect(winMenu, SIGNAL(aboutToHide()), this, SIGNAL(MenuClosed()));
     connect(actMenu, SIGNAL(aboutToHide()), this, SIGNAL(MenuClosed()));
+    connect(actMenu, SIGNAL(triggered(QAction*)), this, SLOT(appActionClicked(QAction*)) );
 }
 
 LTaskButton::~LTaskButton() {
@@ -163,11 +164,28 @@ void LTaskButton::UpdateMenus() {
         actMenu->addAction( LXDG::findIcon("layer-visible-off",""), tr("Minimize All Windows"), this, SLOT(hideAllWindows()) );
         actMenu->addAction( LXDG::findIcon("window-close",""), tr("Close All Windows"), this, SLOT(closeAllWindows()) );
     }
+    //Add the extra actions from the application entry (new window, etc)
+    LWinInfo win = WINLIST.isEmpty() ? cWin : currentWindow();
+    XDGDesktop *desk = win.app();
+    if(desk!=0 && !desk->actions.isEmpty()) {
+        actMenu->addSeparator();
+        for(int i=0; i<desk->actions.length(); i++) {
+            QAction *act = actMenu->addAction( LXDG::findIcon(desk->actions[i].icon, desk->icon), desk->actions[i].name );
+            act->setWhatsThis("-action "+desk->actions[i].ID+" "+desk->filePath);
+        }
+    }
 }
 
 //=============
 //   PRIVATE SLOTS
 //=============
+void LTaskButton::appActionClicked(QAction *act) {
+    if(act->whatsThis().isEmpty()) {
+        return;    //window action - handled by its own slot
+    }
+    LSession::LaunchApplication("7b7b-open "+act->whatsThis());
+}
+
 void LTaskButton::buttonClicked() {
     if(WINLIST.length() > 1) {
         winMenu->popup(QCursor::pos());
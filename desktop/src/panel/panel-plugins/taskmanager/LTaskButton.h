@@ -68,6 +68,7 @@ private slots:
     void closeAllWindows();
     void triggerWindow(); //change b/w visible and invisible
     void winClicked(QAction*);
+    void appActionClicked(QAction*);
     void openActionMenu();
 protected:
     void changeEvent(QEvent *ev) {
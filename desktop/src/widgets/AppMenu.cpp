@@ -14,7 +14,7 @@ AppMenu::AppMenu(QWidget* parent) : QMenu(parent) {
     sysApps = new XDGDesktopList(this, true); //have this one automatically keep in sync
     APPS.clear();
     start(); //do the initial run during session init so things are responsive immediately.
-    connect(QApplication::instance(), SIGNAL(LocaleChanged()), this, SLOT(watcherUpdate()) );
+    connect(QApplication::instance(), SIGNAL(LocaleChanged()), this, SLOT(localeUpdate()) );
     connect(QApplication::instance(), SIGNAL(IconThemeChanged()), this, SLOT(watcherUpdate()) );
 }
 
@@ -36,36 +36,13 @@ void AppMenu::updateAppList() {
     this->setIcon( LXDG::findIcon("system-run","") );
     //Now update the lists
     this->clear();
+    qDeleteAll(catMenus); //also removes the app entries/sub-menus within them
+    catMenus.clear();
+    appEntries.clear();
+    appSubmenus.clear();
     APPS.clear(); //NOTE: Don't delete these pointers - the pointers are managed by the sysApps class and these are just references to them
     //qDebug() << "New Apps List:";
-    if(LSession::handle()->sessionSettings()->value("AutomaticDesktopAppLinks",true).toBool() && !lastHashUpdate.isNull() ) {
-        QString desktop = LUtils::standardDirectory(LUtils::Desktop);
-        desktop.append("/");
-        //qDebug() << "Update Desktop Folder:" << desktop << sysApps->removedApps << sysApps->newApps;
-        QStringList tmp = sysApps->removedApps;
-        for(int i=0; i<tmp.length() && !desktop.isEmpty(); i++) {
-            //Remove any old symlinks first
-            QString filename = tmp[i].section("/",-1);
-            //qDebug() << "Check for symlink:" << filename;
-            if( QFileInfo(desktop+filename).isSymLink() ) {
-                QFile::remove(desktop+filename);
-            }
-        }
-        tmp = sysApps->newApps;
-        for(int i=0; i<tmp.length() && !desktop.isEmpty(); i++) {
-            XDGDesktop *desk = sysApps->files.value(tmp[i]);
-            if(desk->isHidden || !desk->isValid(false) ) {
-                continue;    //skip this one
-            }
-            //qDebug() << "New App: " << tmp[i] << desk.filePath << "Hidden:" << desk.isHidden;
-            //Create a new symlink for this file if one does not exist
-            QString filename = tmp[i].section("/",-1);
-            //qDebug() << "Check for symlink:" << filename;
-            if(!QFile::exists(desktop+filename) ) {
-                QFile::link(tmp[i], desktop+filename);
-            }
-        }
-    }
+    updateDesktopLinks();
     QList<XDGDesktop*> allfiles = sysApps->apps(false,false); //only valid, non-hidden apps
     APPS = LXDG::sortDesktopCats(allfiles);
     APPS.insert("All", LXDG::sortDesktopNames(allfiles));
@@ -76,95 +53,163 @@ void AppMenu::updateAppList() {
     QStringList cats = APPS.keys();
     cats.sort(); //make sure they are alphabetical
     for(int i=0; i<cats.length(); i++) {
-        //Make sure they are translated and have the right icons
-        QString name, icon;
-
-        QStringList submenus = QStringList() << "All" << "Game" << "Network" << "Settings" << "Utility" << "Wine" << "Multimedia" << "Development" << "Education" << "Graphics" << "Office" << "Science" << "System";
-        switch (submenus.indexOf(cats[i])) {
-        case 0:
+        QMenu *menu = createCategoryMenu(cats[i]);
+        if(menu==0) {
             continue;
-            break;
-        case 1:
-            name = tr("Games");
-            icon = "applications-games";
-            break;
-        case 2:
-            name = tr("Network");
-            icon = "applications-internet";
-            break;
-        case 3:
-            name = tr("Settings");
-            icon = "applications-system";
-            break;
-        case 4:
-            name = tr("Utility");
-            icon = "applications-utilities";
-            break;
-        case 5:
-            name = tr("Wine");
-            icon = "wine";
-            break;
-        case 6 ... 12:
-            name = tr(cats[i].toUtf8().constData());
-            icon = "applications-" + cats[i].toLower();
-            break;
-        default:
-            name = tr("Unsorted");
-            icon = "applications-other";
-            break;
         }
-
-        QMenu *menu = new QMenu(name, this);
-        menu->setIcon( ICONS->loadIcon(icon) );
-        //menu->setIcon(LXDG::findIcon(icon,""));
-        connect(menu, SIGNAL(triggered(QAction*)), this, SLOT(launchApp(QAction*)) );
         QList<XDGDesktop*> appL = APPS.value(cats[i]);
         for( int a=0; a<appL.length(); a++) {
-            if(appL[a]->actions.isEmpty()) {
-                //Just a single entry point - no extra actions
-                QAction *act = new QAction(appL[a]->name, this);
-                ICONS->loadIcon(act, appL[a]->icon);
-                act->setToolTip(appL[a]->comment);
-                act->setWhatsThis(appL[a]->filePath);
-                menu->addAction(act);
-            } else {
-                //This app has additional actions - make this a sub menu
-                // - first the main menu/action
-                QMenu *submenu = new QMenu(appL[a]->name, this);
-                submenu->setIcon( ICONS->loadIcon(appL[a]->icon ));
-                //This is the normal behavior - not a special sub-action (although it needs to be at the top of the new menu)
-                QAction *act = new QAction(appL[a]->name, this);
-                ICONS->loadIcon(act, appL[a]->icon);
-                act->setToolTip(appL[a]->comment);
-                act->setWhatsThis(appL[a]->filePath);
-                submenu->addAction(act);
-                //Now add entries for every sub-action listed
-                for(int sa=0; sa<appL[a]->actions.length(); sa++) {
-                    QAction *sact = new QAction( appL[a]->actions[sa].name, this);
-                    if(ICONS->exists(appL[a]->actions[sa].icon)) {
-                        ICONS->loadIcon(sact, appL[a]->actions[sa].icon);
-                    }
-                    else {
-                        ICONS->loadIcon(sact, appL[a]->icon);
-                    }
-                    sact->setToolTip(appL[a]->comment);
-                    sact->setWhatsThis("-action "+appL[a]->actions[sa].ID+" "+appL[a]->filePath);
-                    submenu->addAction(sact);
-                }
-                menu->addMenu(submenu);
-            }
+            addAppEntry(appL[a], menu);
         }
         this->addMenu(menu);
     }
     emit AppMenuUpdated();
 }
 
+void AppMenu::updateDesktopLinks() {
+    if(!LSession::handle()->sessionSettings()->value("AutomaticDesktopAppLinks",true).toBool() || lastHashUpdate.isNull() ) {
+        return;
+    }
+    QString desktop = LUtils::standardDirectory(LUtils::Desktop);
+    desktop.append("/");
+    //qDebug() << "Update Desktop Folder:" << desktop << sysApps->removedApps << sysApps->newApps;
+    QStringList tmp = sysApps->removedApps;
+    for(int i=0; i<tmp.length() && !desktop.isEmpty(); i++) {
+        //Remove any old symlinks first
+        QString filename = tmp[i].section("/",-1);
+        //qDebug() << "Check for symlink:" << filename;
+        if( QFileInfo(desktop+filename).isSymLink() ) {
+            QFile::remove(desktop+filename);
+        }
+    }
+    tmp = sysApps->newApps;
+    for(int i=0; i<tmp.length() && !desktop.isEmpty(); i++) {
+        XDGDesktop *desk = sysApps->files.value(tmp[i]);
+        if(desk==0 || desk->isHidden || !desk->isValid(false) ) {
+            continue;    //skip this one
+        }
+        //qDebug() << "New App: " << tmp[i] << desk.filePath << "Hidden:" << desk.isHidden;
+        //Create a new symlink for this file if one does not exist
+        QString filename = tmp[i].section("/",-1);
+        //qDebug() << "Check for symlink:" << filename;
+        if(!QFile::exists(desktop+filename) ) {
+            QFile::link(tmp[i], desktop+filename);
+        }
+    }
+}
+
+QMenu* AppMenu::createCategoryMenu(QString cat) {
+    //Make sure they are translated and have the right icons
+    QString name, icon;
+
+    QStringList submenus = QStringList() << "All" << "Game" << "Network" << "Settings" << "Utility" << "Wine" << "Multimedia" << "Development" << "Education" << "Graphics" << "Office" << "Science" << "System";
+    switch (submenus.indexOf(cat)) {
+    case 0:
+        return 0; //not shown in the menu
+    case 1:
+        name = tr("Games");
+        icon = "applications-games";
+        break;
+    case 2:
+        name = tr("Network");
+        icon = "applications-internet";
+        break;
+    case 3:
+        name = tr("Settings");
+        icon = "applications-system";
+        break;
+    case 4:
+        name = tr("Utility");
+        icon = "applications-utilities";
+        break;
+    case 5:
+        name = tr("Wine");
+        icon = "wine";
+        break;
+    case 6 ... 12:
+        name = tr(cat.toUtf8().constData());
+        icon = "applications-" + cat.toLower();
+        break;
+    default:
+        name = tr("Unsorted");
+        icon = "applications-other";
+        break;
+    }
+
+    QMenu *menu = new QMenu(name, this);
+    ICONS->loadIcon(menu, icon);
+    //menu->setIcon(LXDG::findIcon(icon,""));
+    connect(menu, SIGNAL(triggered(QAction*)), this, SLOT(launchApp(QAction*)) );
+    catMenus.insert(cat, menu);
+    return menu;
+}
+
+void AppMenu::addAppEntry(XDGDesktop *app, QMenu *menu, QAction *before) {
+    if(app->actions.isEmpty()) {
+        //Just a single entry point - no extra actions
+        QAction *act = new QAction(app->name, menu);
+        ICONS->loadIcon(act, app->icon);
+        act->setToolTip(app->comment);
+        act->setWhatsThis(app->filePath);
+        menu->insertAction(before, act);
+        appEntries.insert(app->filePath, act);
+    } else {
+        //This app has additional actions - make this a sub menu
+        // - first the main menu/action
+        QMenu *submenu = new QMenu(app->name, menu);
+        ICONS->loadIcon(submenu, app->icon);
+        //This is the normal behavior - not a special sub-action (although it needs to be at the top of the new menu)
+        QAction *act = new QAction(app->name, submenu);
+        ICONS->loadIcon(act, app->icon);
+        act->setToolTip(app->comment);
+        act->setWhatsThis(app->filePath);
+        submenu->addAction(act);
+        //Now add entries for every sub-action listed
+        for(int sa=0; sa<app->actions.length(); sa++) {
+            QAction *sact = new QAction( app->actions[sa].name, submenu);
+            if(ICONS->exists(app->actions[sa].icon)) {
+                ICONS->loadIcon(sact, app->actions[sa].icon);
+            }
+            else {
+                ICONS->loadIcon(sact, app->icon);
+            }
+            sact->setToolTip(app->comment);
+            sact->setWhatsThis("-action "+app->actions[sa].ID+" "+app->filePath);
+            submenu->addAction(sact);
+        }
+        menu->insertMenu(before, submenu);
+        appEntries.insert(app->filePath, submenu->menuAction());
+        appSubmenus.insert(app->filePath, submenu);
+    }
+}
+
+void AppMenu::removeAppEntry(QString path) {
+    //Drop the references from the category lists
+    QStringList cats = APPS.keys();
+    for(int i=0; i<cats.length(); i++) {
+        QList<XDGDesktop*> appL = APPS.value(cats[i]);
+        for(int a=appL.length()-1; a>=0; a--) {
+            if(appL[a]->filePath==path) {
+                appL.removeAt(a);
+            }
+        }
+        APPS.insert(cats[i], appL);
+    }
+    //Now remove the menu entry
+    if(appSubmenus.contains(path)) {
+        delete appSubmenus.take(path); //also removes the entry action
+        appEntries.remove(path);
+    } else if(appEntries.contains(path)) {
+        delete appEntries.take(path);
+    }
+}
+
 //=================
 //  PRIVATE SLOTS
 //=================
 void AppMenu::start() {
     //Setup the watcher
-    connect(sysApps, SIGNAL(appsUpdated()), this, SLOT(watcherUpdate()) );
+    connect(sysApps, SIGNAL(appsUpdated(QStringList, QStringList, QStringList)), this, SLOT(appsChanged(QStringList, QStringList, QStringList)) );
     sysApps->updateList();
     //Now fill the menu the first time
     updateAppList();
@@ -174,6 +219,59 @@ void AppMenu::watcherUpdate() {
     updateAppList(); //Update the menu listings
 }
 
+void AppMenu::localeUpdate() {
+    sysApps->setLocale( QLocale().name() ); //re-label the entries (no rescan)
+    updateAppList();
+}
+
+void AppMenu::appsChanged(QStringList added, QStringList removed, QStringList changed) {
+    //Patch the existing menus with just the entries which changed
+    if(lastHashUpdate.isNull() || catMenus.isEmpty()) {
+        updateAppList();
+        return;
+    }
+    updateDesktopLinks();
+    //NOTE: The old XDGDesktop pointers for removed/changed apps are already scheduled for deletion
+    QStringList drop = removed + changed;
+    for(int i=0; i<drop.length(); i++) {
+        removeAppEntry(drop[i]);
+    }
+    QStringList insert = added + changed;
+    for(int i=0; i<insert.length(); i++) {
+        XDGDesktop *desk = sysApps->files.value(insert[i], 0);
+        if(desk==0 || desk->isHidden || !desk->isValid(false) ) {
+            continue;    //not shown in the menu
+        }
+        QString cat = LXDG::sortDesktopCats(QList<XDGDesktop*>() << desk).keys().value(0);
+        if(!catMenus.contains(cat)) {
+            updateAppList(); //brand new category - just rebuild the menu
+            return;
+        }
+        APPS.insert("All", LXDG::sortDesktopNames(APPS.value("All") << desk));
+        QList<XDGDesktop*> appL = LXDG::sortDesktopNames(APPS.value(cat) << desk);
+        APPS.insert(cat, appL);
+        if(!appL.contains(desk)) {
+            continue;    //hidden behind another app with the same name (same as a full rebuild)
+        }
+        //Insert before the next app in the sorted list
+        QAction *before = 0;
+        for(int a=appL.indexOf(desk)+1; a<appL.length() && before==0; a++) {
+            before = appEntries.value(appL[a]->filePath, 0);
+        }
+        addAppEntry(desk, catMenus.value(cat), before);
+    }
+    //Clean up any categories which are now empty
+    QStringList cats = catMenus.keys();
+    for(int i=0; i<cats.length(); i++) {
+        if(APPS.value(cats[i]).isEmpty()) {
+            APPS.remove(cats[i]);
+            delete catMenus.take(cats[i]);
+        }
+    }
+    lastHashUpdate = QDateTime::currentDateTime();
+    emit AppMenuUpdated();
+}
+
 void AppMenu::launchApp(QAction *act) {
     QString appFile = act->whatsThis();
     LSession::LaunchApplication("7b7b-open "+appFile);
@@ -31,6 +31,9 @@ public:
     ~AppMenu();
 
     QHash<QString, QList<XDGDesktop*> > *currentAppHash();
+    XDGDesktopList* appList() {
+        return sysApps;
+    }
     QDateTime lastHashUpdate;
 
 private:
@@ -38,12 +41,21 @@ private:
     QList<QMenu> MLIST;
     XDGDesktopList *sysApps;
     QHash<QString, QList<XDGDesktop*> > APPS;
+    QHash<QString, QMenu*> catMenus; //<category>/<menu>
+    QHash<QString, QAction*> appEntries; //<app file path>/<entry within the category menu>
+    QHash<QString, QMenu*> appSubmenus; //<app file path>/<sub-menu> (apps with extra actions only)
 
     void updateAppList(); //completely update the menu lists
+    void updateDesktopLinks(); //sync the desktop folder symlinks with the new/removed apps
+    QMenu* createCategoryMenu(QString cat);
+    void addAppEntry(XDGDesktop *app, QMenu *menu, QAction *before = 0);
+    void removeAppEntry(QString path);
 
 private slots:
     void start(); //This is called in a new thread after initialization
     void watcherUpdate();
+    void localeUpdate();
+    void appsChanged(QStringList added, QStringList removed, QStringList changed);
     void launchApp(QAction *act);
 
 signals:
@@ -113,7 +113,8 @@ void MainUI::SyncFileInfo() {
     if(fileINFO->filePath().isEmpty()) {
         return;
     }
-    QString mime = LXDG::findAppMimeForFile(fileINFO->fileName());
+    XDGFileType type = LXDG::classifyFile(fileINFO->absoluteFilePath());
+    QString mime = type.mime;
 
     if (!fileINFO->isDir()) {
         ui->label_file_name->setText( fileINFO->fileName() );
@@ -172,20 +173,16 @@ void MainUI::SyncFileInfo() {
     ui->label_file_type->setText(ftype);
 
     // Nows the icons
-    QString icon;
+    QString icon = type.icon;
     if (fileINFO->suffix() == "desktop") {
         XDGDesktop *desk = new XDGDesktop(fileINFO->absoluteFilePath(), 0);
         icon = QString(desk->icon);
     }
-    //Now load the icon for the file
-    if(mime.startsWith("image/")) {
-        icon = "image-x-generic";
-    } else if(mime.startsWith("video/")) {
-        icon = "video-x-generic";
-    } else if (fileINFO->isDir() ) {
-        icon = "folder";
-    }
-    
-    ui->label_file_icon->setPixmap( LXDG::findIcon( icon, "unknown").pixmap(QSize(64,64)) );
-    this->setWindowIcon( LXDG::findIcon( icon, "unknown") );
+    //Now load the icon for the file (generic icon for the type if the theme does not have that one)
+    QIcon ico = LXDG::findIcon( icon, type.genericIcon);
+    if(ico.isNull()) {
+        ico = LXDG::findIcon("unknown","");
+    }
+    ui->label_file_icon->setPixmap( ico.pixmap(QSize(64,64)) );
+    this->setWindowIcon( ico );
 }
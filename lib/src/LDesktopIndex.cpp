@@ -0,0 +1,221 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LDesktopIndex.h"
+#include "LuminaXDG.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#define INDEX_MAGIC 0x37623762 //"7b7b"
+#define INDEX_VERSION 3 //bump whenever the record layout below changes
+
+//Record payload layout (shared by save/restore)
+static void writeDesktop(QDataStream &out, XDGDesktop *desk) {
+    out << (qint32) desk->type << desk->name << desk->genericName << desk->comment << desk->icon;
+    out << desk->showInList << desk->notShowInList << desk->isHidden;
+    out << desk->exec << desk->tryexec << desk->path << desk->startupWM;
+    out << desk->actionList << desk->mimeList << desk->catList << desk->keyList;
+    out << desk->useTerminal << desk->startupNotify << desk->useVGL << desk->url;
+    out << desk->localeData() << desk->hasLocaleData();
+    out << (qint32) desk->actions.length();
+    for(int i=0; i<desk->actions.length(); i++) {
+        out << desk->actions[i].ID << desk->actions[i].name << desk->actions[i].icon << desk->actions[i].exec;
+    }
+}
+
+static bool readDesktop(QDataStream &in, XDGDesktop *desk) {
+    qint32 type, num;
+    QByteArray loctable;
+    bool locall;
+    in >> type >> desk->name >> desk->genericName >> desk->comment >> desk->icon;
+    in >> desk->showInList >> desk->notShowInList >> desk->isHidden;
+    in >> desk->exec >> desk->tryexec >> desk->path >> desk->startupWM;
+    in >> desk->actionList >> desk->mimeList >> desk->catList >> desk->keyList;
+    in >> desk->useTerminal >> desk->startupNotify >> desk->useVGL >> desk->url;
+    in >> loctable >> locall;
+    in >> num;
+    desk->setLocaleData(loctable, locall);
+    desk->type = (XDGDesktop::XDGDesktopType) type;
+    desk->actions.clear();
+    for(qint32 i=0; i<num && in.status()==QDataStream::Ok; i++) {
+        XDGDesktopAction act;
+        in >> act.ID >> act.name >> act.icon >> act.exec;
+        desk->actions << act;
+    }
+    return (in.status()==QDataStream::Ok);
+}
+
+LDesktopIndex::LDesktopIndex() {
+    mapped = 0;
+    mappedSize = 0;
+}
+
+LDesktopIndex::~LDesktopIndex() {
+    close();
+}
+
+QString LDesktopIndex::indexPath() {
+    QString dir = QString(getenv("XDG_CACHE_HOME")).section(":",0,0);
+    if(dir.isEmpty()) {
+        dir = QDir::homePath()+"/.cache";
+    }
+    dir.append("/7b7b");
+    if(!QFile::exists(dir)) {
+        QDir D;
+        D.mkpath(dir);
+    }
+    return (dir+"/applications.index");
+}
+
+bool LDesktopIndex::load() {
+    close();
+    file.setFileName(indexPath());
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    mappedSize = file.size();
+    mapped = file.map(0, mappedSize);
+    if(mapped==0) {
+        file.close();
+        mappedSize = 0;
+        return false;
+    }
+    //Only walk the record headers here - payloads are decoded on demand
+    QByteArray raw = QByteArray::fromRawData((const char*) mapped, mappedSize);
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version, num;
+    in >> magic >> version >> locale;
+    //NOTE: A different locale is fine - the entries get re-labeled on restore
+    if(in.status()!=QDataStream::Ok || magic!=INDEX_MAGIC || version!=INDEX_VERSION) {
+        close();
+        return false;
+    }
+    in >> num;
+    for(quint32 i=0; i<num && in.status()==QDataStream::Ok; i++) {
+        QString dir;
+        DirListing dlist;
+        in >> dir >> dlist.mtime >> dlist.entries;
+        dirs.insert(dir, dlist);
+    }
+    in >> num;
+    for(quint32 i=0; i<num && in.status()==QDataStream::Ok; i++) {
+        QString path;
+        record rec;
+        in >> path >> rec.mtime >> rec.size >> rec.length;
+        rec.offset = in.device()->pos();
+        if(in.skipRawData(rec.length) != (int) rec.length) {
+            in.setStatus(QDataStream::ReadPastEnd);
+            break;
+        }
+        records.insert(path, rec);
+    }
+    in >> num;
+    for(quint32 i=0; i<num && in.status()==QDataStream::Ok; i++) {
+        QString path;
+        FileStamp stamp;
+        in >> path >> stamp.mtime >> stamp.size;
+        badfiles.insert(path, stamp);
+    }
+    if(in.status()!=QDataStream::Ok) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LDesktopIndex::close() {
+    records.clear();
+    badfiles.clear();
+    locale.clear();
+    dirs.clear();
+    if(mapped!=0) {
+        file.unmap(mapped);
+        mapped = 0;
+    }
+    mappedSize = 0;
+    if(file.isOpen()) {
+        file.close();
+    }
+}
+
+bool LDesktopIndex::dirUnchanged(QString dir, qint64 mtime) {
+    if(!dirs.contains(dir)) {
+        return false;
+    }
+    return (dirs.value(dir).mtime == mtime);
+}
+
+QStringList LDesktopIndex::dirEntries(QString dir) {
+    return dirs.value(dir).entries;
+}
+
+bool LDesktopIndex::restore(XDGDesktop *desk, QString path, qint64 mtime, qint64 size) {
+    if(mapped==0 || !records.contains(path)) {
+        return false;
+    }
+    record rec = records.value(path);
+    if(rec.mtime!=mtime || rec.size!=size || (rec.offset+rec.length) > mappedSize) {
+        return false;    //file changed since the index was written
+    }
+    QByteArray raw = QByteArray::fromRawData((const char*) (mapped+rec.offset), rec.length);
+    QDataStream in(raw);
+    in.setVersion(QDataStream::Qt_6_0);
+    if(!readDesktop(in, desk)) {
+        return false;
+    }
+    desk->filePath = path;
+    desk->lastRead = QDateTime::currentDateTime();
+    if(locale!=XDGDesktop::activeLocale()) {
+        return desk->relabel(XDGDesktop::activeLocale()); //also compacts
+    }
+    desk->compact();
+    return true;
+}
+
+bool LDesktopIndex::save(const QHash<QString, XDGDesktop*> &files, const QHash<QString, DirListing> &listing, const QHash<QString, FileStamp> &bad) {
+    QSaveFile out(indexPath());
+    if(!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream str(&out);
+    str.setVersion(QDataStream::Qt_6_0);
+    str << (quint32) INDEX_MAGIC << (quint32) INDEX_VERSION << XDGDesktop::activeLocale();
+    str << (quint32) listing.count();
+    for(QHash<QString, DirListing>::const_iterator it = listing.constBegin(); it!=listing.constEnd(); ++it) {
+        str << it.key() << it.value().mtime << it.value().entries;
+    }
+    //Skip any entries which changed on disk after they were parsed (re-parse next time)
+    QList<QString> keys;
+    QList<QFileInfo> infos;
+    for(QHash<QString, XDGDesktop*>::const_iterator it = files.constBegin(); it!=files.constEnd(); ++it) {
+        QFileInfo info(it.key());
+        if(info.exists() && info.lastModified() < it.value()->lastRead) {
+            keys << it.key();
+            infos << info;
+        }
+    }
+    str << (quint32) keys.length();
+    for(int i=0; i<keys.length(); i++) {
+        QByteArray payload;
+        QDataStream ps(&payload, QIODevice::WriteOnly);
+        ps.setVersion(QDataStream::Qt_6_0);
+        writeDesktop(ps, files.value(keys[i]));
+        str << keys[i] << infos[i].lastModified().toMSecsSinceEpoch() << infos[i].size() << (quint32) payload.size();
+        str.writeRawData(payload.constData(), payload.size());
+    }
+    str << (quint32) bad.count();
+    for(QHash<QString, FileStamp>::const_iterator it = bad.constBegin(); it!=bad.constEnd(); ++it) {
+        str << it.key() << it.value().mtime << it.value().size;
+    }
+    if(str.status()!=QDataStream::Ok) {
+        out.cancelWriting();
+        return false;
+    }
+    return out.commit();
+}
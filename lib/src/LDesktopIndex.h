@@ -0,0 +1,83 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a persistent on-disk index of parsed *.desktop entries
+//  Location: $XDG_CACHE_HOME/7b7b/applications.index
+//  The file is memory-mapped on load and individual records are only
+//  decoded when a matching (path, mtime, size) is requested, so a warm
+//  start only needs to re-parse files which actually changed.
+//  Files which did not parse into a usable entry are kept as (mtime, size)
+//  stamps, so they do not get re-parsed (and the index re-written) every time.
+//===========================================
+#ifndef _LUMINA_LIBRARY_DESKTOP_INDEX_H
+#define _LUMINA_LIBRARY_DESKTOP_INDEX_H
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class XDGDesktop;
+
+class LDesktopIndex {
+public:
+    //Directory listing as recorded at scan time
+    struct DirListing {
+        qint64 mtime; //msecs since epoch
+        QStringList entries; //*.desktop filenames (not paths)
+    };
+    //File state for entries which could not be used (type BAD)
+    struct FileStamp {
+        qint64 mtime; //msecs since epoch
+        qint64 size;
+        bool operator==(const FileStamp &other) const {
+            return (mtime==other.mtime && size==other.size);
+        }
+    };
+
+    LDesktopIndex();
+    ~LDesktopIndex();
+
+    //Full path to the index file (creates the cache dir as needed)
+    static QString indexPath();
+
+    //Map the index file into memory (returns false if missing/stale/corrupt)
+    bool load();
+    //Release the mapped file
+    void close();
+    bool isLoaded() {
+        return (mapped!=0);
+    }
+
+    //Directory checks: the cached listing is only valid if the dir mtime is unchanged
+    bool dirUnchanged(QString dir, qint64 mtime);
+    QStringList dirEntries(QString dir); //filenames (not paths) recorded for this dir
+
+    //Fill in the structure from the index if the file is unchanged (mtime in msecs)
+    bool restore(XDGDesktop *desk, QString path, qint64 mtime, qint64 size);
+    //Was this file recorded as unusable (and is unchanged since then)?
+    bool isBad(QString path, qint64 mtime, qint64 size) {
+        return (badfiles.contains(path) && badfiles.value(path)==FileStamp{mtime, size});
+    }
+
+    //Write out a new index file (atomically replaces the old one)
+    static bool save(const QHash<QString, XDGDesktop*> &files, const QHash<QString, DirListing> &listing, const QHash<QString, FileStamp> &bad);
+
+private:
+    struct record {
+        qint64 mtime, size;
+        qint64 offset; //start of the payload within the mapped file
+        quint32 length;
+    };
+    QFile file;
+    uchar *mapped;
+    qint64 mappedSize;
+    QHash<QString, record> records;
+    QHash<QString, FileStamp> badfiles;
+    QHash<QString, DirListing> dirs;
+    QString locale; //active locale when the index was written
+};
+
+#endif
@@ -0,0 +1,217 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LDesktopSearch.h"
+#include "LuminaXDG.h"
+
+#include <algorithm>
+
+#define PREFIX_MAX 2 //queries longer than this use the trigram postings
+#define FUZZY_RATIO 0.6 //fraction of the query trigrams needed for a partial match
+
+static inline quint64 packTrigram(const QChar *ch) {
+    return ( ((quint64) ch[0].unicode())<<32 ) | ( ((quint64) ch[1].unicode())<<16 ) | ((quint64) ch[2].unicode());
+}
+
+static QStringList splitWords(const QString &text) {
+    QStringList out;
+    int start = -1;
+    for(int i=0; i<=text.length(); i++) {
+        bool isword = (i<text.length()) && text[i].isLetterOrNumber();
+        if(isword && start<0) {
+            start = i;
+        } else if(!isword && start>=0) {
+            out << text.mid(start, i-start);
+            start = -1;
+        }
+    }
+    return out;
+}
+
+static bool wordStartsWith(const QStringList &words, const QString &query) {
+    for(int i=0; i<words.length(); i++) {
+        if(words[i].startsWith(query)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+LDesktopSearch::LDesktopSearch() {
+
+}
+
+QString LDesktopSearch::normalize(QString text) {
+    //Decompose (so accents become separate marks), drop the marks, then fold the case
+    QString decomp = text.normalized(QString::NormalizationForm_KD);
+    QString out;
+    out.reserve(decomp.length());
+    for(int i=0; i<decomp.length(); i++) {
+        if(decomp[i].category()!=QChar::Mark_NonSpacing) {
+            out.append(decomp[i]);
+        }
+    }
+    return out.toCaseFolded();
+}
+
+void LDesktopSearch::clear() {
+    entries.clear();
+    prefixes.clear();
+    trigrams.clear();
+    lastQuery.clear();
+    lastMatches.clear();
+}
+
+void LDesktopSearch::addPosting(QVector<int> &list, int index) {
+    //Entries are indexed in order, so only the last item needs checking for duplicates
+    if(list.isEmpty() || list.last()!=index) {
+        list << index;
+    }
+}
+
+void LDesktopSearch::indexText(const QString &text, int index) {
+    const QChar *ch = text.constData();
+    for(int i=0; i+2<text.length(); i++) {
+        addPosting(trigrams[packTrigram(ch+i)], index);
+    }
+}
+
+void LDesktopSearch::build(QList<XDGDesktop*> apps) {
+    clear();
+    entries.reserve(apps.length());
+    for(int i=0; i<apps.length(); i++) {
+        entry ent;
+        ent.desk = apps[i];
+        ent.name = normalize(apps[i]->name);
+        ent.generic = normalize(apps[i]->genericName);
+        ent.keywords = normalize(apps[i]->keyList.join(" "));
+        ent.comment = normalize(apps[i]->comment);
+        ent.nameWords = splitWords(ent.name);
+        ent.words = ent.nameWords + splitWords(ent.generic) + splitWords(ent.keywords);
+        int index = entries.length();
+        for(int w=0; w<ent.words.length(); w++) {
+            for(int len=1; len<=PREFIX_MAX && len<=ent.words[w].length(); len++) {
+                addPosting(prefixes[ent.words[w].left(len)], index);
+            }
+        }
+        indexText(ent.name, index);
+        indexText(ent.generic, index);
+        indexText(ent.keywords, index);
+        indexText(ent.comment, index);
+        entries << ent;
+    }
+}
+
+//Entries which match the (normalized) query exactly - see the class notes for the rules
+QVector<int> LDesktopSearch::matches(const QString &query) {
+    QVector<int> out;
+    if(query.length()<=PREFIX_MAX) {
+        //Word-prefix match: the postings are already exact
+        return prefixes.value(query);
+    }
+    QVector<int> cands;
+    if(!lastQuery.isEmpty() && lastQuery.length()>PREFIX_MAX && query.startsWith(lastQuery)) {
+        cands = lastMatches; //only adding characters - the matches can only shrink
+    } else {
+        //Intersect the trigram postings (shortest list first)
+        QList< QVector<int> > lists;
+        const QChar *ch = query.constData();
+        for(int i=0; i+2<query.length(); i++) {
+            QHash<quint64, QVector<int> >::const_iterator it = trigrams.constFind(packTrigram(ch+i));
+            if(it==trigrams.constEnd()) {
+                return out;    //this trigram is not anywhere
+            }
+            lists << it.value();
+        }
+        std::sort(lists.begin(), lists.end(), [](const QVector<int> &a, const QVector<int> &b) {
+            return a.length() < b.length();
+        });
+        cands = lists.takeFirst();
+        for(int i=0; i<lists.length() && !cands.isEmpty(); i++) {
+            QVector<int> tmp;
+            std::set_intersection(cands.begin(), cands.end(), lists[i].begin(), lists[i].end(), std::back_inserter(tmp));
+            cands = tmp;
+        }
+    }
+    //The trigrams might be in different places - verify the full substring
+    for(int i=0; i<cands.length(); i++) {
+        const entry &ent = entries[cands[i]];
+        if(ent.name.contains(query) || ent.generic.contains(query) || ent.keywords.contains(query) || ent.comment.contains(query)) {
+            out << cands[i];
+        }
+    }
+    return out;
+}
+
+int LDesktopSearch::score(const entry &ent, const QString &query) {
+    int pts = 0;
+    if(ent.name==query) {
+        pts = 1000;
+    } else if(ent.name.startsWith(query)) {
+        pts = 800;
+    } else if(wordStartsWith(ent.nameWords, query)) {
+        pts = 600;
+    } else if(ent.name.contains(query)) {
+        pts = 400;
+    } else if(ent.generic.startsWith(query)) {
+        pts = 300;
+    } else if(wordStartsWith(ent.words, query)) {
+        pts = 250; //generic name/keyword word
+    } else if(ent.generic.contains(query) || ent.keywords.contains(query)) {
+        pts = 150;
+    } else if(ent.comment.contains(query)) {
+        pts = 50;
+    }
+    //Prefer shorter names when everything else is equal
+    return (pts*100 - qMin(ent.name.length(), 99));
+}
+
+QList<XDGDesktop*> LDesktopSearch::search(QString query, int max) {
+    QList<XDGDesktop*> out;
+    query = normalize(query.simplified());
+    if(query.isEmpty() || max<1) {
+        lastQuery.clear();
+        lastMatches.clear();
+        return out;
+    }
+    QVector<int> found = matches(query);
+    lastQuery = query;
+    lastMatches = found;
+    QList< QPair<int, int> > ranked; //score, entry
+    ranked.reserve(found.length());
+    for(int i=0; i<found.length(); i++) {
+        ranked << qMakePair(score(entries[found[i]], query), found[i]);
+    }
+    //Not enough exact matches: add partial trigram matches (small typos)
+    if(ranked.length()<max && query.length()>PREFIX_MAX) {
+        QHash<int, int> hits;
+        const QChar *ch = query.constData();
+        int total = query.length()-2;
+        for(int i=0; i<total; i++) {
+            QVector<int> list = trigrams.value(packTrigram(ch+i));
+            for(int j=0; j<list.length(); j++) {
+                hits[list[j]]++;
+            }
+        }
+        int needed = qMax(1, (int) (total*FUZZY_RATIO + 0.99));
+        for(QHash<int, int>::const_iterator it = hits.constBegin(); it!=hits.constEnd(); ++it) {
+            if(it.value()>=needed && !found.contains(it.key())) {
+                ranked << qMakePair(it.value()*10 - total*10, it.key()); //always below the exact matches
+            }
+        }
+    }
+    //Only the top "max" need to be in order
+    int num = qMin(max, (int) ranked.length());
+    std::partial_sort(ranked.begin(), ranked.begin()+num, ranked.end(), [this](const QPair<int, int> &a, const QPair<int, int> &b) {
+        if(a.first!=b.first) {
+            return a.first > b.first;
+        }
+        return entries[a.second].name < entries[b.second].name;
+    });
+    for(int i=0; i<num; i++) {
+        out << entries[ranked[i].second].desk;
+    }
+    return out;
+}
@@ -0,0 +1,61 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a search index over a list of applications (type-to-launch)
+//  All text is case-folded and stripped of accents before indexing.
+//  - Short queries (1-2 chars) match the start of any word in the name/generic name/keywords
+//  - Longer queries match anywhere in the name/generic name/keywords/comment (trigram postings),
+//     and fall back on partial trigram matches to cover small typos
+//  Typing more characters onto the previous query only re-checks the previous matches.
+//===========================================
+#ifndef _LUMINA_LIBRARY_DESKTOP_SEARCH_H
+#define _LUMINA_LIBRARY_DESKTOP_SEARCH_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class XDGDesktop;
+
+class LDesktopSearch {
+public:
+    LDesktopSearch();
+
+    //(Re)build the index for these apps (the pointers must stay valid until the next build/clear)
+    void build(QList<XDGDesktop*> apps);
+    void clear();
+    int count() {
+        return entries.length();
+    }
+
+    //Best matches first (at most "max" results)
+    QList<XDGDesktop*> search(QString query, int max = 10);
+
+    //Case-folded text without accents/diacritics
+    static QString normalize(QString text);
+
+private:
+    struct entry {
+        XDGDesktop *desk;
+        QString name, generic, keywords, comment; //normalized
+        QStringList nameWords; //normalized words from the name
+        QStringList words; //normalized words from the name/generic name/keywords
+    };
+    QList<entry> entries;
+    QHash<QString, QVector<int> > prefixes; //first 1-2 chars of each word -> entries
+    QHash<quint64, QVector<int> > trigrams; //packed trigram -> entries (sorted)
+    //State from the last query (refined when the next query just adds characters)
+    QString lastQuery;
+    QVector<int> lastMatches;
+
+    void addPosting(QVector<int> &list, int index);
+    void indexText(const QString &text, int index);
+    QVector<int> matches(const QString &query);
+    int score(const entry &ent, const QString &query);
+};
+
+#endif
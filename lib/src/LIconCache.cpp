@@ -9,17 +9,36 @@
 #include "LuminaOS.h"
 #include "LUtils.h"
 #include "LuminaXDG.h"
+#include "LIconSharedCache.h"
+#include "LIconThemeIndex.h"
 
+#include <QApplication>
 #include <QDir>
+#include <QImageReader>
+#include <QStyle>
+#include <QThread>
+#include <QtMath>
+
+#include <algorithm>
 #include <QtConcurrent>
 
+//Nominal cost of an unsized icon (QIcon on the file - pixmaps get rendered and cached by Qt on demand)
+#define UNSIZED_ICON_BYTES (64*64*4)
+
 LIconCache::LIconCache(QObject *parent) : QObject(parent) {
-    connect(this, SIGNAL(InternalIconLoaded(QString, QDateTime, QByteArray*)), this, SLOT(IconLoaded(QString, QDateTime, QByteArray*)) );
+    usecount = hits = misses = evictions = cancelled = 0;
+    bytes = 0;
+    budget = 32*1024*1024;
+    //Separate threads for icon files so they do not wait behind (or hold up) everything else in the global pool
+    POOL = new QThreadPool(this);
+    POOL->setMaxThreadCount( qBound(1, QThread::idealThreadCount()/2, 4) );
+    connect(this, SIGNAL(InternalIconLoaded(QString, QDateTime, QImage)), this, SLOT(IconLoaded(QString, QDateTime, QImage)) );
 }
 
 LIconCache::~LIconCache() {
-
-
+    urgentQueue.clear();
+    idleQueue.clear();
+    POOL->waitForDone(); //the running reads still post back to this object
 }
 
 LIconCache* LIconCache::instance() {
@@ -38,10 +57,7 @@ bool LIconCache::exists(QString icon) {
     }
     else if(!icon.startsWith("/")) {
         //relative path to file (from icon theme?)
-        QString path = findFile(icon);
-        if(!path.isEmpty() && QFile::exists(path)) {
-            return true;
-        }
+        return !findFile(icon).isEmpty();
     } else {
         //absolute path to file
         return QFile::exists(icon);
@@ -59,7 +75,7 @@ bool LIconCache::isLoaded(QString icon) {
     return false;
 }
 
-QString LIconCache::findFile(QString icon) {
+QString LIconCache::findFile(QString icon, int size, int scale) {
     if(icon.isEmpty()) {
         return "";
     }
@@ -70,72 +86,12 @@ QString LIconCache::findFile(QString icon) {
         QIcon::setThemeName("material-design-light");
         cTheme = "material-design-light";
     }
-    //Make sure the current search paths correspond to this theme
-    if( QDir::searchPaths("icontheme").filter("/"+cTheme+"/").isEmpty() ) {
-        //Need to reset search paths: setup the "icontheme" "material-design-light" and "fallback" sets
-        // - Get all the base icon directories
-        QStringList paths;
-        paths << QDir::homePath()+"/.icons/"; //ordered by priority - local user dirs first
-        QStringList xdd = QString(getenv("XDG_DATA_HOME")).split(":");
-        xdd << QString(getenv("XDG_DATA_DIRS")).split(":");
-        for(int i=0; i<xdd.length(); i++) {
-            if(QFile::exists(xdd[i]+"/icons")) {
-                paths << xdd[i]+"/icons/";
-            }
-        }
-        //Now load all the dirs into the search paths
-        QStringList theme, oxy, fall;
-        QStringList themedeps = LXDG::getIconThemeDepChain(cTheme, paths);
-        for(int i=0; i<paths.length(); i++) {
-            theme << getChildIconDirs( paths[i]+cTheme);
-            for(int j=0; j<themedeps.length(); j++) {
-                theme << getChildIconDirs(paths[i]+themedeps[j]);
-            }
-            oxy << getChildIconDirs(paths[i]+"material-design-light"); //7b7b base icon set
-            fall << getChildIconDirs(paths[i]+"hicolor"); //XDG fallback (apps add to this)
-        }
-        //Now load all the icon theme dependencies in order (Theme1 -> Theme2 -> Theme3 -> Fallback)
-
-        //fall << LOS::AppPrefix()+"share/pixmaps"; //always use this as well as a final fallback
-        QDir::setSearchPaths("icontheme", theme);
-        QDir::setSearchPaths("default", oxy);
-        QDir::setSearchPaths("fallback", fall);
-        //qDebug() << "Setting Icon Search Paths:" << "\nicontheme:" << theme << "\nmaterial-design-light:" << oxy << "\nfallback:" << fall;
-    }
-    //Find the icon in the search paths
-    QIcon ico;
-    QStringList srch;
-    srch << "icontheme" << "default" << "fallback";
-    for(int i=0; i<srch.length() && ico.isNull(); i++) {
-        if(QFile::exists(srch[i]+":"+icon+".svg") && !icon.contains("libreoffice") ) {
-            return QFileInfo(srch[i]+":"+icon+".svg").absoluteFilePath();
-        } else if(QFile::exists(srch[i]+":"+icon+".png")) {
-            return QFileInfo(srch[i]+":"+icon+".png").absoluteFilePath();
-        }
-    }
-    //If still no icon found, look for any image format in the "pixmaps" directory
-    if(QFile::exists(LOS::AppPrefix()+"share/pixmaps/"+icon)) {
-        if(QFileInfo(LOS::AppPrefix()+"share/pixmaps/"+icon).isDir()) {
-            return "";
-        }
-        return (LOS::AppPrefix()+"share/pixmaps/"+icon);
-    } else {
-        //Need to scan for any close match in the directory
-        QDir pix(LOS::AppPrefix()+"share/pixmaps");
-        QStringList formats = LUtils::imageExtensions();
-        QStringList found = pix.entryList(QStringList() << icon, QDir::Files, QDir::Unsorted);
-        if(found.isEmpty()) {
-            found = pix.entryList(QStringList() << icon+"*", QDir::Files, QDir::Unsorted);
-        }
-        //qDebug() << "Found pixmaps:" << found << formats;
-        //Use the first one found that is a valid format
-        for(int i=0; i<found.length(); i++) {
-            if( formats.contains(found[i].section(".",-1).toLower()) ) {
-                return pix.absoluteFilePath(found[i]);
-            }
-        }
+    //Make sure the index corresponds to this theme (icon theme -> inherited themes -> 7b7b base set -> hicolor -> share/pixmaps)
+    LIconThemeIndex *index = LIconThemeIndex::instance();
+    if(index->theme()!=cTheme) {
+        index->setTheme(cTheme);
     }
-    return ""; //no file found
+    return index->find(icon, size, scale);
 }
 
 
@@ -143,38 +99,37 @@ void LIconCache::loadIcon(QAbstractButton *button, QString icon, bool noThumb) {
     if(icon.isEmpty()) {
         return;
     }
-    if(icon=="appcafe") {
-        qDebug() << "appcafe icon:" << isThemeIcon(icon) << HASH.contains(icon);
-    }
     if(isThemeIcon(icon)) {
-        button->setIcon( iconFromTheme(icon));
-        return ;
+        QIcon ico = LIconSharedCache::themeIcon(icon, QIcon::fromTheme(icon));
+        if(!ico.isNull()) {
+            button->setIcon( ico );
+            return;
+        }
+        //missing in the theme - find the closest file for this size below
     }
-    //See if the icon has already been loaded into the HASH
-    bool needload = !HASH.contains(icon);
+    int size = button->iconSize().height();
+    int scale = qCeil(button->devicePixelRatioF());
+    QString id = cacheKey(icon, size, scale);
+    //See if the icon has already been loaded into the HASH (entries get used in place)
+    bool needload = !HASH.contains(id);
+    icon_data &idata = (needload) ? createData(id, icon, size, scale) : HASH[id];
+    idata.used = ++usecount;
     if(!needload) {
-        if(!noThumb && !HASH[icon].thumbnail.isNull()) {
-            button->setIcon( HASH[icon].thumbnail );
+        if(!noThumb && !idata.thumbnail.isNull()) {
+            button->setIcon( idata.thumbnail );
+            hits++;
             return;
         }
-        else if(!HASH[icon].icon.isNull()) {
-            button->setIcon( HASH[icon].icon );
+        else if(!idata.icon.isNull()) {
+            button->setIcon( idata.icon );
+            hits++;
             return;
         }
     }
     //Need to load the icon
-    icon_data idata;
-    if(HASH.contains(icon)) {
-        idata = HASH.value(icon);
-    }
-    else {
-        idata = createData(icon);
-    }
+    misses++;
     idata.pendingButtons << QPointer<QAbstractButton>(button); //save this button for later
-    HASH.insert(icon, idata);
-    if(needload) {
-        startReadFile(icon, idata.fullpath);
-    }
+    startReadFile(id, isShowing(button));
 }
 
 void LIconCache::loadIcon(QAction *action, QString icon, bool noThumb) {
@@ -182,34 +137,36 @@ void LIconCache::loadIcon(QAction *action, QString icon, bool noThumb) {
         return;
     }
     if(isThemeIcon(icon)) {
-        action->setIcon( iconFromTheme(icon));
-        return ;
+        QIcon ico = LIconSharedCache::themeIcon(icon, QIcon::fromTheme(icon));
+        if(!ico.isNull()) {
+            action->setIcon( ico );
+            return;
+        }
+        //missing in the theme - find the closest file for this size below
     }
-    //See if the icon has already been loaded into the HASH
-    bool needload = !HASH.contains(icon);
+    int size = menuIconSize();
+    int scale = qCeil(qApp->devicePixelRatio());
+    QString id = cacheKey(icon, size, scale);
+    //See if the icon has already been loaded into the HASH (entries get used in place)
+    bool needload = !HASH.contains(id);
+    icon_data &idata = (needload) ? createData(id, icon, size, scale) : HASH[id];
+    idata.used = ++usecount;
     if(!needload) {
-        if(!noThumb && !HASH[icon].thumbnail.isNull()) {
-            action->setIcon( HASH[icon].thumbnail );
+        if(!noThumb && !idata.thumbnail.isNull()) {
+            action->setIcon( idata.thumbnail );
+            hits++;
             return;
         }
-        else if(!HASH[icon].icon.isNull()) {
-            action->setIcon( HASH[icon].icon );
+        else if(!idata.icon.isNull()) {
+            action->setIcon( idata.icon );
+            hits++;
             return;
         }
     }
     //Need to load the icon
-    icon_data idata;
-    if(HASH.contains(icon)) {
-        idata = HASH.value(icon);
-    }
-    else {
-        idata = createData(icon);
-    }
-    idata.pendingActions << QPointer<QAction>(action); //save this button for later
-    HASH.insert(icon, idata);
-    if(needload) {
-        startReadFile(icon, idata.fullpath);
-    }
+    misses++;
+    idata.pendingActions << QPointer<QAction>(action); //save this action for later
+    startReadFile(id, isShowing(action));
 }
 
 void LIconCache::loadIcon(QLabel *label, QString icon, bool noThumb) {
@@ -217,37 +174,40 @@ void LIconCache::loadIcon(QLabel *label, QString icon, bool noThumb) {
         return;
     }
     if(isThemeIcon(icon)) {
-        label->setPixmap( iconFromTheme(icon).pixmap(label->sizeHint()) );
-        return ;
+        QIcon ico = LIconSharedCache::themeIcon(icon, QIcon::fromTheme(icon));
+        if(!ico.isNull()) {
+            label->setPixmap( ico.pixmap(label->sizeHint(), label->devicePixelRatioF()) );
+            return;
+        }
+        //missing in the theme - find the closest file for this size below
     }
-    //See if the icon has already been loaded into the HASH
-    bool needload = !HASH.contains(icon);
+    int size = qMin(label->sizeHint().width(), label->sizeHint().height());
+    int scale = qCeil(label->devicePixelRatioF());
+    QString id = cacheKey(icon, size, scale);
+    //See if the icon has already been loaded into the HASH (entries get used in place)
+    bool needload = !HASH.contains(id);
+    icon_data &idata = (needload) ? createData(id, icon, size, scale) : HASH[id];
+    idata.used = ++usecount;
     if(!needload) {
-        if(!noThumb && !HASH[icon].thumbnail.isNull()) {
-            label->setPixmap( HASH[icon].thumbnail.pixmap(label->sizeHint()) );
+        if(!noThumb && !idata.thumbnail.isNull()) {
+            label->setPixmap( idata.thumbnail.pixmap(label->sizeHint(), label->devicePixelRatioF()) );
+            hits++;
             return;
         }
-        else if(!HASH[icon].icon.isNull()) {
-            label->setPixmap( HASH[icon].icon.pixmap(label->sizeHint()) );
+        else if(!idata.icon.isNull()) {
+            label->setPixmap( idata.icon.pixmap(label->sizeHint(), label->devicePixelRatioF()) );
+            hits++;
             return;
         }
     }
     //Need to load the icon
-    icon_data idata;
-    if(HASH.contains(icon)) {
-        idata = HASH.value(icon);
-    }
-    else {
-        idata = createData(icon);
-        if(idata.fullpath.isEmpty()) {
-            return;    //nothing to do
-        }
+    misses++;
+    if(needload && idata.fullpath.isEmpty()) {
+        HASH.remove(id);
+        return;    //nothing to do
     }
     idata.pendingLabels << QPointer<QLabel>(label); //save this QLabel for later
-    HASH.insert(icon, idata);
-    if(needload) {
-        startReadFile(icon, idata.fullpath);
-    }
+    startReadFile(id, isShowing(label));
 }
 
 void LIconCache::loadIcon(QMenu *action, QString icon, bool noThumb) {
@@ -255,263 +215,391 @@ void LIconCache::loadIcon(QMenu *action, QString icon, bool noThumb) {
         return;
     }
     if(isThemeIcon(icon)) {
-        action->setIcon( iconFromTheme(icon));
-        return ;
+        QIcon ico = LIconSharedCache::themeIcon(icon, QIcon::fromTheme(icon));
+        if(!ico.isNull()) {
+            action->setIcon( ico );
+            return;
+        }
+        //missing in the theme - find the closest file for this size below
     }
-    //See if the icon has already been loaded into the HASH
-    bool needload = !HASH.contains(icon);
+    int size = menuIconSize();
+    int scale = qCeil(action->devicePixelRatioF());
+    QString id = cacheKey(icon, size, scale);
+    //See if the icon has already been loaded into the HASH (entries get used in place)
+    bool needload = !HASH.contains(id);
+    icon_data &idata = (needload) ? createData(id, icon, size, scale) : HASH[id];
+    idata.used = ++usecount;
     if(!needload) {
-        if(!noThumb && !HASH[icon].thumbnail.isNull()) {
-            action->setIcon( HASH[icon].thumbnail );
+        if(!noThumb && !idata.thumbnail.isNull()) {
+            action->setIcon( idata.thumbnail );
+            hits++;
             return;
         }
-        else if(!HASH[icon].icon.isNull()) {
-            action->setIcon( HASH[icon].icon );
+        else if(!idata.icon.isNull()) {
+            action->setIcon( idata.icon );
+            hits++;
             return;
         }
     }
     //Need to load the icon
-    icon_data idata;
-    if(HASH.contains(icon)) {
-        idata = HASH.value(icon);
-    }
-    else {
-        idata = createData(icon);
-    }
-    idata.pendingMenus << QPointer<QMenu>(action); //save this button for later
-    HASH.insert(icon, idata);
-    if(needload) {
-        startReadFile(icon, idata.fullpath);
-    }
+    misses++;
+    idata.pendingMenus << QPointer<QMenu>(action); //save this menu for later
+    startReadFile(id, isShowing(action->menuAction()));
 }
 
 void LIconCache::clearIconTheme() {
     //use when the icon theme changes to refresh all requested icons
+    LIconThemeIndex::instance()->reload();
+    LIconSharedCache::instance()->clear(); //the other processes would keep getting the old pixels otherwise
     QStringList keys = HASH.keys();
     for(int i=0; i<keys.length(); i++) {
         //remove all relative icons (
-        if(!keys.startsWith("/")) {
+        if(!keys[i].startsWith("/")) {
+            bytes -= HASH[keys[i]].bytes;
             HASH.remove(keys[i]);
         }
     }
 }
 
 QIcon LIconCache::loadIcon(QString icon, bool noThumb) {
+    return loadIcon(icon, 0, 1, noThumb);
+}
+
+QIcon LIconCache::loadIcon(QString icon, int size, qreal dpr, bool noThumb) {
     if(icon.isEmpty()) {
         return QIcon();
     }
     if(isThemeIcon(icon)) {
-        return iconFromTheme(icon);
-    }
-
-    if(HASH.contains(icon)) {
-        if(!HASH[icon].icon.isNull()) {
-            return HASH[icon].icon;
-        }
-        else if(!HASH[icon].thumbnail.isNull() && !noThumb) {
-            return HASH[icon].thumbnail;
+        QIcon ico = LIconSharedCache::themeIcon(icon, QIcon::fromTheme(icon));
+        if(!ico.isNull()) {
+            return ico;
         }
     }
-    //Not loaded yet - need to load it right now
-    icon_data idat;
-    if(HASH.contains(icon)) {
-        idat = HASH[icon];
+    int scale = qCeil(dpr);
+    QString id = cacheKey(icon, size, scale);
+    bool needload = !HASH.contains(id);
+    icon_data &idat = (needload) ? createData(id, icon, size, scale) : HASH[id];
+    idat.used = ++usecount;
+    if(!idat.icon.isNull()) {
+        hits++;
+        return idat.icon;
     }
-    else {
-        idat = createData(icon);
+    else if(!idat.thumbnail.isNull() && !noThumb) {
+        hits++;
+        return idat.thumbnail;
     }
+    //Not loaded yet - need to load it right now
+    misses++;
     if(idat.fullpath.isEmpty()) {
+        if(needload) {
+            HASH.remove(id);
+        }
         return QIcon();    //non-existant file
     }
-    idat.icon = QIcon(idat.fullpath);
-    //Now save into the hash and return
-    HASH.insert(icon, idat);
+    if(size>0) {
+        QPixmap pix = QPixmap::fromImage( decodeFile(idat.fullpath, size, scale) );
+        if(!pix.isNull()) {
+            idat.icon.addPixmap(pix);
+            setBytes(idat, pix);
+        }
+    }
+    else {
+        idat.icon = QIcon(idat.fullpath);
+        setBytes(idat, UNSIZED_ICON_BYTES);
+    }
+    //No need to read it in the background any more
+    urgentQueue.removeAll(id);
+    idleQueue.removeAll(id);
+    notifyPending(idat);
+    QIcon ico = idat.icon;
+    trim(id);
     emit IconAvailable(icon);
-    return idat.icon;
+    return ico;
 }
 
 void LIconCache::clearAll() {
     HASH.clear();
+    urgentQueue.clear();
+    idleQueue.clear();
+    bytes = 0;
+}
+
+void LIconCache::setMemoryBudget(qint64 bytes) {
+    budget = bytes;
+    trim("");
+}
+
+icon_cache_stats LIconCache::stats() {
+    icon_cache_stats out;
+    out.hits = hits;
+    out.misses = misses;
+    out.evictions = evictions;
+    out.cancelled = cancelled;
+    out.bytes = bytes;
+    out.budget = budget;
+    out.entries = HASH.count();
+    return out;
 }
 
 // === PRIVATE ===
-icon_data LIconCache::createData(QString icon) {
-    icon_data idat;
+icon_data& LIconCache::createData(QString id, QString icon, int size, int scale) {
+    icon_data &idat = HASH[id];
+    idat.name = icon;
+    idat.size = size;
+    idat.scale = scale;
+    idat.bytes = 0;
+    idat.used = 0;
     //Find the real path of the icon
     if(icon.startsWith("/")) {
         idat.fullpath = icon;    //already full path
     }
     else {
-        idat.fullpath = findFile(icon);
+        idat.fullpath = findFile(icon, size, scale);
     }
     return idat;
 }
 
-QStringList LIconCache::getChildIconDirs(QString path) {
-//This is a recursive function that returns the absolute path(s) of directories with *.png files
-    QDir D(path);
-    QStringList out;
-    QStringList dirs = D.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-    if(!dirs.isEmpty() && (dirs.contains("32x32") || dirs.contains("scalable")) ) {
-        //Need to sort these directories by image size
-        //qDebug() << " - Parent:" << parent << "Dirs:" << dirs;
-        for(int i=0; i<dirs.length(); i++) {
-            if(dirs[i].contains("x")) {
-                dirs[i].prepend( QString::number(10-dirs[i].section("x",0,0).length())+QString::number(10-dirs[i].at(0).digitValue())+"::::");
-            }
-            else if(dirs[i].at(0).isNumber()) {
-                dirs[i].prepend( QString::number(10-dirs[i].length())+QString::number(10-dirs[i].at(0).digitValue())+"::::");
-            }
-            else {
-                dirs[i].prepend( "0::::");
-            }
-        }
-        dirs.sort();
-        for(int i=0; i<dirs.length(); i++) {
-            dirs[i] = dirs[i].section("::::",1,50);    //chop the sorter off the front again
-        }
-        //qDebug() << "Sorted:" << dirs;
-    }
-    QStringList img = D.entryList(QStringList() << "*.png" << "*.svg", QDir::Files | QDir::NoDotAndDotDot, QDir::NoSort);
-    if(img.length() > 0) {
-        out << D.absolutePath();
-    }
-    for(int i=0; i<dirs.length(); i++) {
-        img.clear();
-        img = getChildIconDirs(D.absoluteFilePath(dirs[i])); //re-use the old list variable
-        if(img.length() > 0) {
-            out << img;
+void LIconCache::setBytes(icon_data &idat, const QPixmap &pix) {
+    setBytes(idat, ((qint64) pix.width())*pix.height()*pix.depth()/8);
+}
+
+void LIconCache::setBytes(icon_data &idat, qint64 count) {
+    bytes -= idat.bytes;
+    idat.bytes = count;
+    bytes += idat.bytes;
+}
+
+void LIconCache::trim(QString keep) {
+    if(budget<=0 || bytes<=budget) {
+        return;
+    }
+    //Drop the least-recently used icons (which are not still loading) until there is some room again
+    QList<QPair<quint64, QString> > order;
+    for(QHash<QString, icon_data>::const_iterator it = HASH.constBegin(); it!=HASH.constEnd(); ++it) {
+        const icon_data &idat = it.value();
+        bool pending = !(idat.pendingButtons.isEmpty() && idat.pendingLabels.isEmpty() && idat.pendingActions.isEmpty() && idat.pendingMenus.isEmpty());
+        if(it.key()!=keep && !pending && idat.bytes>0) {
+            order << qMakePair(idat.used, it.key());
+        }
+    }
+    std::sort(order.begin(), order.end());
+    qint64 target = budget - budget/10; //leave some slack so this does not run on every load
+    for(int i=0; i<order.length() && bytes>target; i++) {
+        bytes -= HASH[order[i].second].bytes;
+        HASH.remove(order[i].second);
+        evictions++;
+    }
+}
+
+bool LIconCache::isWanted(const icon_data &idat) {
+    for(int i=0; i<idat.pendingButtons.length(); i++) {
+        if(!idat.pendingButtons[i].isNull()) {
+            return true;
         }
     }
-    return out;
+    for(int i=0; i<idat.pendingLabels.length(); i++) {
+        if(!idat.pendingLabels[i].isNull()) {
+            return true;
+        }
+    }
+    for(int i=0; i<idat.pendingActions.length(); i++) {
+        if(!idat.pendingActions[i].isNull()) {
+            return true;
+        }
+    }
+    for(int i=0; i<idat.pendingMenus.length(); i++) {
+        if(!idat.pendingMenus[i].isNull()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LIconCache::notifyPending(icon_data &idat) {
+    for(int i=0; i<idat.pendingButtons.length(); i++) {
+        if(!idat.pendingButtons[i].isNull()) {
+            idat.pendingButtons[i]->setIcon(idat.icon);
+        }
+    }
+    idat.pendingButtons.clear();
+    for(int i=0; i<idat.pendingLabels.length(); i++) {
+        if(!idat.pendingLabels[i].isNull()) {
+            idat.pendingLabels[i]->setPixmap(idat.icon.pixmap(idat.pendingLabels[i]->sizeHint(), idat.pendingLabels[i]->devicePixelRatioF()));
+        }
+    }
+    idat.pendingLabels.clear();
+    for(int i=0; i<idat.pendingActions.length(); i++) {
+        if(!idat.pendingActions[i].isNull()) {
+            idat.pendingActions[i]->setIcon(idat.icon);
+        }
+    }
+    idat.pendingActions.clear();
+    for(int i=0; i<idat.pendingMenus.length(); i++) {
+        if(!idat.pendingMenus[i].isNull()) {
+            idat.pendingMenus[i]->setIcon(idat.icon);
+        }
+    }
+    idat.pendingMenus.clear();
+}
+
+bool LIconCache::isShowing(QWidget *wgt) {
+    //Widgets usually get their icon before they are shown - go by the window they are going into instead
+    return (wgt->isVisible() || wgt->window()->isVisible());
+}
+
+bool LIconCache::isShowing(QAction *action) {
+    //On screen if any of the widgets it was added to is (menus which are not open yet do not count)
+    QList<QObject*> objs = action->associatedObjects();
+    for(int i=0; i<objs.length(); i++) {
+        QWidget *wgt = qobject_cast<QWidget*>(objs[i]);
+        if(wgt!=0 && isShowing(wgt)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString LIconCache::cacheKey(QString icon, int size, int scale) {
+    if(size<=0) {
+        return icon;
+    }
+    return icon+"@"+QString::number(size)+"x"+QString::number(scale);
+}
+
+int LIconCache::menuIconSize() {
+    return QApplication::style()->pixelMetric(QStyle::PM_SmallIconSize);
 }
 
-QStringList LIconCache::getIconThemeDepChain(QString theme, QStringList paths) {
-    QStringList results;
-    for(int i=0; i<paths.length(); i++) {
-        if( QFile::exists(paths[i]+theme+"/index.theme") ) {
-            QStringList deps = LUtils::readFile(paths[i]+theme+"/index.theme").filter("Inherits=");
-            if(!deps.isEmpty()) {
-                deps = deps.first().section("=",1,-1).split(";",Qt::SkipEmptyParts);
-                for(int j=0; j<deps.length(); j++) {
-                    results << deps[j] << getIconThemeDepChain(deps[j],paths);
-                }
-            }
-            break; //found primary theme index file - stop here
+QImage LIconCache::decodeFile(QString path, int size, int scale) {
+    //Decode straight to the requested size (safe to use from any thread - QImage only)
+    QImageReader reader(path);
+    QSize target(size*scale, size*scale);
+    if(size>0) {
+        QSize full = reader.size();
+        if(full.isValid()) {
+            reader.setScaledSize( full.scaled(target, Qt::KeepAspectRatio) ); //SVGs get rendered at this size, bitmaps get decoded/scaled by the format plugin
         }
     }
-    return results;
+    QImage img = reader.read();
+    if(img.isNull() || size<=0) {
+        return img;
+    }
+    if(img.width()!=target.width() && img.height()!=target.height()) {
+        img = img.scaled(target, Qt::KeepAspectRatio, Qt::SmoothTransformation);    //format without scaled reads
+    }
+    img.setDevicePixelRatio(scale);
+    return img;
 }
 
-void LIconCache::startReadFile(QString id, QString path) {
-    if(path.endsWith(".svg")) {
-        //Special handling - need to read QIcon directly to have the SVG icon scale up appropriately
-        icon_data idat = HASH[id];
+void LIconCache::startReadFile(QString id, bool urgent) {
+    icon_data &idat = HASH[id];
+    if(idat.fullpath.endsWith(".svg") && idat.size<=0) {
+        //Special handling - no size to render at: use the QIcon directly to have the SVG icon scale up appropriately
         idat.lastread = QDateTime::currentDateTime();
-        idat.icon = QIcon(path);
-        for(int i=0; i<idat.pendingButtons.length(); i++) {
-            if(!idat.pendingButtons[i].isNull()) {
-                idat.pendingButtons[i]->setIcon(idat.icon);
-            }
-        }
-        idat.pendingButtons.clear();
-        for(int i=0; i<idat.pendingLabels.length(); i++) {
-            if(!idat.pendingLabels[i].isNull()) {
-                idat.pendingLabels[i]->setPixmap(idat.icon.pixmap(idat.pendingLabels[i]->sizeHint()));
-            }
-        }
-        idat.pendingLabels.clear();
-        for(int i=0; i<idat.pendingActions.length(); i++) {
-            if(!idat.pendingActions[i].isNull()) {
-                idat.pendingActions[i]->setIcon(idat.icon);
-            }
-        }
-        idat.pendingActions.clear();
-        for(int i=0; i<idat.pendingMenus.length(); i++) {
-            if(!idat.pendingMenus[i].isNull()) {
-                idat.pendingMenus[i]->setIcon(idat.icon);
-            }
-        }
-        idat.pendingMenus.clear();
-        //Now update the hash and let the world know it is available now
-        HASH.insert(id, idat);
-        this->emit IconAvailable(id);
-    } else {
-        //QtConcurrent::run(this, &LIconCache::ReadFile, this, id, path);
-        //QtConcurrent::run(&LIconCache::ReadFile, this, id, path);
-        QtConcurrent::run([=] {
-            LIconCache::ReadFile(this, id, path);
+        idat.icon = QIcon(idat.fullpath);
+        setBytes(idat, UNSIZED_ICON_BYTES);
+        notifyPending(idat);
+        //Now make room if needed and let the world know it is available now
+        QString name = idat.name;
+        trim(id);
+        this->emit IconAvailable(name);
+        return;
+    }
+    if(idat.size>0 && isThemeIcon(idat.name) && !reading.contains(id)) {
+        //Another process might have rendered this one already
+        QImage img = LIconSharedCache::instance()->find(QIcon::themeName(), idat.name, idat.size, idat.scale);
+        if(!img.isNull()) {
+            urgentQueue.removeAll(id);
+            idleQueue.removeAll(id);
+            IconLoaded(id, QDateTime::currentDateTime(), img);
+            return;
+        }
+    }
+    queueRead(id, urgent);
+}
+
+void LIconCache::queueRead(QString id, bool urgent) {
+    if(reading.contains(id)) {
+        return;    //already being read - the result goes to everything waiting on it
+    }
+    if(urgent) {
+        //Something on screen wants it - move it to the front
+        if(idleQueue.removeAll(id)>0 || !urgentQueue.contains(id)) {
+            urgentQueue << id;
+        }
+    } else if(!urgentQueue.contains(id) && !idleQueue.contains(id)) {
+        idleQueue << id;
+    }
+    startJobs();
+}
+
+void LIconCache::startJobs() {
+    while(reading.count() < POOL->maxThreadCount() && !(urgentQueue.isEmpty() && idleQueue.isEmpty()) ) {
+        QString id = urgentQueue.isEmpty() ? idleQueue.takeFirst() : urgentQueue.takeFirst();
+        if(!HASH.contains(id)) {
+            continue;    //cleared while waiting
+        }
+        icon_data &idat = HASH[id];
+        if(!isWanted(idat)) {
+            //Everything which asked for it is gone already - drop the load
+            HASH.remove(id);
+            cancelled++;
+            continue;
+        }
+        //Decode/render in the background - only the QPixmap conversion happens in the GUI thread
+        reading << id;
+        QString path = idat.fullpath;
+        int size = idat.size;
+        int scale = idat.scale;
+        QtConcurrent::run(POOL, [=] {
+            LIconCache::ReadFile(this, id, path, size, scale);
         });
     }
 }
 
-void LIconCache::ReadFile(LIconCache *obj, QString id, QString path) {
+void LIconCache::ReadFile(LIconCache *obj, QString id, QString path, int size, int scale) {
     //qDebug() << "Start Reading File:" << id << path;
-    QByteArray *BA = new QByteArray();
     QDateTime cdt = QDateTime::currentDateTime();
+    QImage img;
     if(!path.isEmpty()) {
-        QFile file(path);
-        if(file.open(QIODevice::ReadOnly)) {
-            BA->append(file.readAll());
-            file.close();
-        }
+        img = decodeFile(path, size, scale);
     }
-    obj->emit InternalIconLoaded(id, cdt, BA);
+    obj->emit InternalIconLoaded(id, cdt, img);
 }
 
 bool LIconCache::isThemeIcon(QString id) {
     return (!id.contains("/") && !id.contains(".") ); //&& !id.contains("libreoffice") );
 }
 
-QIcon LIconCache::iconFromTheme(QString id) {
-    QIcon ico = QIcon::fromTheme(id);
-    if(ico.isNull()) {
-        //icon missing in theme? run the old icon-finder system
-        ico = QIcon(findFile(id));
-    }
-    return ico;
-}
-
 // === PRIVATE SLOTS ===
-void LIconCache::IconLoaded(QString id, QDateTime sync, QByteArray *data) {
+void LIconCache::IconLoaded(QString id, QDateTime sync, QImage img) {
     //qDebug() << "Icon Loaded:" << id << HASH.contains(id);
-    QPixmap pix;
-    bool ok = pix.loadFromData(*data);
-    delete data; //no longer used - free this up
+    if(reading.remove(id)) {
+        startJobs();    //thread available for the next one
+    }
     if(!HASH.contains(id)) {
         return;    //icon loading cancelled - just stop here
     }
-    if(!ok) {
+    if(img.isNull()) {
         HASH.remove(id);    //icon data corrupted or unreadable
     }
     else {
-        icon_data idat = HASH[id];
+        icon_data &idat = HASH[id];
+        if(!idat.icon.isNull()) {
+            return;    //already loaded directly in the meantime
+        }
         idat.lastread = sync;
-        idat.icon.addPixmap(pix);
-        if(pix.width() < 64) {
-            idat.icon.addPixmap( pix.scaled( QSize(64,64), Qt::KeepAspectRatio, Qt::SmoothTransformation) );    //also add a version which has been scaled up a bit
+        if(idat.size>0 && isThemeIcon(idat.name)) {
+            LIconSharedCache::instance()->insert(QIcon::themeName(), idat.name, idat.size, idat.scale, img);    //no-op unless this is the writer
         }
+        QPixmap pix = QPixmap::fromImage(img); //already decoded at the requested size
+        idat.icon.addPixmap(pix);
+        setBytes(idat, pix);
         //Now throw this icon into any pending objects
-        for(int i=0; i<idat.pendingButtons.length(); i++) {
-            if(!idat.pendingButtons[i].isNull()) {
-                idat.pendingButtons[i]->setIcon(idat.icon);
-            }
-        }
-        idat.pendingButtons.clear();
-        for(int i=0; i<idat.pendingLabels.length(); i++) {
-            if(!idat.pendingLabels[i].isNull()) {
-                idat.pendingLabels[i]->setPixmap(pix.scaled(idat.pendingLabels[i]->sizeHint(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
-            }
-        }
-        idat.pendingLabels.clear();
-        for(int i=0; i<idat.pendingActions.length(); i++) {
-            if(!idat.pendingActions[i].isNull()) {
-                idat.pendingActions[i]->setIcon(idat.icon);
-            }
-        }
-        idat.pendingActions.clear();
-        //Now update the hash and let the world know it is available now
-        HASH.insert(id, idat);
-        this->emit IconAvailable(id);
+        notifyPending(idat);
+        //Now make room if needed and let the world know it is available now
+        QString name = idat.name;
+        trim(id);
+        this->emit IconAvailable(name);
     }
 }
@@ -13,6 +13,7 @@
 #include <QHash>
 #include <QIcon>
 #include <QPixmap>
+#include <QImage>
 #include <QFileSystemWatcher>
 #include <QString>
 #include <QFile>
@@ -21,9 +22,13 @@
 #include <QLabel>
 #include <QAction>
 #include <QPointer>
+#include <QSet>
+#include <QThreadPool>
 
 //Data structure for saving the icon/information internally
 struct icon_data {
+    QString name; //icon as requested
+    int size, scale; //requested size in logical pixels (0: unsized) and device pixel ratio
     QString fullpath;
     QDateTime lastread;
     QList<QPointer<QLabel> > pendingLabels;
@@ -32,6 +37,16 @@ struct icon_data {
     QList<QPointer<QMenu> > pendingMenus;
     QIcon icon;
     QIcon thumbnail;
+    qint64 bytes; //pixel memory held by the icon (nominal for unsized icons)
+    quint64 used; //for least-recently-used eviction
+};
+
+//Counters for sizing the cache (LIconCache::stats())
+struct icon_cache_stats {
+    quint64 hits, misses, evictions;
+    quint64 cancelled; //background loads dropped because nothing wanted them any more
+    qint64 bytes, budget;
+    int entries;
 };
 
 class LIconCache : public QObject {
@@ -48,39 +63,59 @@ public:
     //Icon Checks
     bool exists(QString icon);
     bool isLoaded(QString icon);
-    QString findFile(QString icon); //find the full path of a given file/name (searching the current Icon theme)
+    QString findFile(QString icon, int size = 0, int scale = 1); //find the full path of a given file/name (searching the current Icon theme)
 
     //Special loading routines for QLabel and QAbstractButton (pushbutton, toolbutton, etc)
+    // These load the icon at the size the widget shows it (button/label size, or the menu icon size) and its device pixel ratio
     void loadIcon(QAbstractButton *button, QString icon, bool noThumb = false);
     void loadIcon(QLabel *label, QString icon, bool noThumb = false);
     void loadIcon(QAction *action, QString icon, bool noThumb = false);
     void loadIcon(QMenu *action, QString icon, bool noThumb = false);
 
     QIcon loadIcon(QString icon, bool noThumb = false); //generic loading routine - does not background the loading of icons when not in the cache
+    QIcon loadIcon(QString icon, int size, qreal dpr, bool noThumb = false); //same thing for a specific size (logical pixels)
 
     void clearIconTheme(); //use when the icon theme changes to refresh all requested icons
     void clearAll(); //Clear all cached icons
 
+    //Memory budget for the loaded icons (bytes - least-recently used icons get dropped past this, 0: no limit)
+    void setMemoryBudget(qint64 bytes);
+    icon_cache_stats stats(); //"7b7b-desktop --icon-stats" writes these to the session log
+
 private:
     QHash<QString, icon_data> HASH;
     QFileSystemWatcher *WATCHER;
+    QThreadPool *POOL; //dedicated (bounded) threads for reading icon files
+    QStringList urgentQueue, idleQueue; //waiting for a thread: icons for widgets on screen, everything else (closed menus, hidden widgets)
+    QSet<QString> reading; //icons being read right now
+    quint64 usecount, hits, misses, evictions, cancelled;
+    qint64 bytes, budget;
 
-    icon_data createData(QString icon);
-    QStringList getChildIconDirs(QString path); //recursive function to find directories with icons in them
-    QStringList getIconThemeDepChain(QString theme, QStringList paths);
+    icon_data& createData(QString id, QString icon, int size, int scale); //new HASH entry
+    void setBytes(icon_data &idat, const QPixmap &pix);
+    void setBytes(icon_data &idat, qint64 count);
+    void trim(QString keep); //evict icons until the budget is met again
+    static QString cacheKey(QString icon, int size, int scale); //HASH key for an icon at a specific size
+    static int menuIconSize();
+    static QImage decodeFile(QString path, int size, int scale);
 
-    void startReadFile(QString id, QString path);
+    void startReadFile(QString id, bool urgent); //load the file for an entry (background unless it is an unsized SVG)
+    void queueRead(QString id, bool urgent); //one background read per entry - later requests just move it up
+    void startJobs(); //hand queued reads to the pool while there are threads free
+    static bool isWanted(const icon_data &idat); //any of the pending objects still around?
+    void notifyPending(icon_data &idat); //give the loaded icon to all the pending objects
+    static bool isShowing(QWidget *wgt); //on screen (or about to be) - these get read first
+    static bool isShowing(QAction *action);
     //void ReadFile(LIconCache *obj, QString &id, QString &path);
-    void ReadFile(LIconCache *obj, QString id, QString path);
+    void ReadFile(LIconCache *obj, QString id, QString path, int size, int scale);
 
     bool isThemeIcon(QString id);
-    QIcon iconFromTheme(QString id);
 
 private slots:
-    void IconLoaded(QString id, QDateTime sync, QByteArray *data);
+    void IconLoaded(QString id, QDateTime sync, QImage img);
 
 signals:
-    void InternalIconLoaded(QString, QDateTime, QByteArray*); //INTERNAL SIGNAL - DO NOT USE in other classes/objects
+    void InternalIconLoaded(QString, QDateTime, QImage); //INTERNAL SIGNAL - DO NOT USE in other classes/objects
     void IconAvailable(QString); //way for classes to listen/reload icons as they change
 };
 
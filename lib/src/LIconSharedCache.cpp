@@ -0,0 +1,388 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LIconSharedCache.h"
+#include "LIconThemeIndex.h"
+
+#include <QHash>
+#include <QIconEngine>
+#include <QPainter>
+#include <QPixmap>
+#include <QtMath>
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHM_MAGIC 0x37627369 //"7bsi"
+#define SHM_VERSION 2
+#define SHM_ENTRIES 8192
+#define SHM_KEY_SIZE 112
+#define SHM_ARENA_SIZE (32*1024*1024)
+#define SHM_MAX_PROBES 32
+#define SHM_MAX_DIM 4096 //largest icon side (pixels) kept in the cache
+
+//Segment layout: header, entry table, pixel data
+struct shm_header {
+    quint32 magic, version, entries, keysize;
+    quint64 arenasize;
+    std::atomic<quint64> used; //bytes of the arena handed out so far
+    std::atomic<quint32> resets;
+};
+struct shm_entry {
+    std::atomic<quint32> seq; //odd while the entry is being written
+    quint32 valid;
+    quint32 hash;
+    quint32 width, height, bytesPerLine;
+    quint64 offset; //pixel data in the arena
+    quint32 scale;
+    char key[SHM_KEY_SIZE];
+};
+
+#define SHM_TABLE_OFFSET ((sizeof(shm_header)+63) & ~((size_t) 63))
+#define SHM_ARENA_OFFSET ((SHM_TABLE_OFFSET + SHM_ENTRIES*sizeof(shm_entry) + 63) & ~((size_t) 63))
+#define SHM_TOTAL_SIZE (SHM_ARENA_OFFSET + SHM_ARENA_SIZE)
+
+static QByteArray segmentName() {
+    return "/7b7b-icons-"+QByteArray::number(getuid());
+}
+
+static QByteArray entryKey(QString theme, QString name, int size, int scale) {
+    return (theme+"\n"+name+"\n"+QString::number(size)+"\n"+QString::number(scale)).toUtf8();
+}
+
+// ==================
+//  Icon engine for the themed icons (pixmaps come out of the shared cache first)
+// ==================
+class LSharedIconEngine : public QIconEngine {
+public:
+    LSharedIconEngine(QString name, QIcon icon) {
+        iconname = name;
+        fallback = icon;
+    }
+
+    QPixmap pixmap(const QSize &size, QIcon::Mode mode, QIcon::State state) override {
+        return scaledPixmap(size, mode, state, 1.0);
+    }
+
+    QPixmap scaledPixmap(const QSize &size, QIcon::Mode mode, QIcon::State state, qreal scale) override {
+        if(mode!=QIcon::Normal || state!=QIcon::Off || size.isEmpty()) {
+            return fallback.pixmap(size, scale, mode, state);
+        }
+        int isize = qMin(size.width(), size.height());
+        int iscale = qMax(1, qCeil(scale));
+        quint64 memo = (((quint64) isize) << 32) | iscale;
+        if(pixmaps.contains(memo)) {
+            return pixmaps.value(memo);
+        }
+        QString theme = QIcon::themeName();
+        LIconSharedCache *cache = LIconSharedCache::instance();
+        QPixmap pix;
+        QImage img = cache->find(theme, iconname, isize, iscale);
+        if(!img.isNull()) {
+            pix = QPixmap::fromImage(img);
+        }
+        else {
+            pix = fallback.pixmap(QSize(isize, isize), iscale, mode, state);
+            if(!pix.isNull()) {
+                cache->insert(theme, iconname, isize, iscale, pix.toImage());
+            }
+        }
+        pixmaps.insert(memo, pix);
+        return pix;
+    }
+
+    void paint(QPainter *painter, const QRect &rect, QIcon::Mode mode, QIcon::State state) override {
+        qreal dpr = (painter->device()!=0) ? painter->device()->devicePixelRatio() : 1.0;
+        QPixmap pix = scaledPixmap(rect.size(), mode, state, dpr);
+        QSize psize = pix.deviceIndependentSize().toSize();
+        QRect target(rect.topLeft(), psize);
+        target.moveCenter(rect.center());
+        painter->drawPixmap(target, pix);
+    }
+
+    QSize actualSize(const QSize &size, QIcon::Mode mode, QIcon::State state) override {
+        return fallback.actualSize(size, mode, state);
+    }
+
+    QList<QSize> availableSizes(QIcon::Mode mode, QIcon::State state) override {
+        return fallback.availableSizes(mode, state);
+    }
+
+    QString key() const override {
+        return "7b7bShared";
+    }
+
+    QIconEngine* clone() const override {
+        return new LSharedIconEngine(iconname, fallback);
+    }
+
+    QString iconName() override {
+        return iconname;
+    }
+
+    bool isNull() override {
+        return fallback.isNull();
+    }
+
+private:
+    QString iconname;
+    QIcon fallback;
+    QHash<quint64, QPixmap> pixmaps; //<size, scale> -> pixmap already handed out
+};
+
+// ==================
+//  Shared cache
+// ==================
+LIconSharedCache* LIconSharedCache::instance() {
+    static LIconSharedCache *CACHE = 0;
+    static QMutex initmutex;
+    QMutexLocker lock(&initmutex);
+    if(CACHE==0) {
+        CACHE = new LIconSharedCache();
+    }
+    return CACHE;
+}
+
+LIconSharedCache::LIconSharedCache() {
+    data.store(0);
+    oldmap = 0;
+    writer.store(false);
+    tried.store(false);
+    generation = 0;
+}
+
+LIconSharedCache::~LIconSharedCache() {
+    if(data.load()!=0) {
+        munmap(data.load(), SHM_TOTAL_SIZE);
+    }
+    if(oldmap!=0) {
+        munmap(oldmap, SHM_TOTAL_SIZE);
+    }
+}
+
+bool LIconSharedCache::openWriter() {
+    QMutexLocker lock(&mutex);
+    if(writer.load()) {
+        return true;
+    }
+    //Keep any read-only mapping around - readers might still be in the middle of a copy from it
+    uchar *map = attach(true);
+    tried.store(true);
+    if(map==0) {
+        return false;
+    }
+    oldmap = data.load();
+    generation = LIconThemeIndex::instance()->generation();
+    data.store(map, std::memory_order_release);
+    writer.store(true);
+    reset(); //new session: the icon files might have changed since the last one
+    return true;
+}
+
+bool LIconSharedCache::isAttached() {
+    if(data.load(std::memory_order_acquire)!=0) {
+        return true;
+    }
+    if(tried.load()) {
+        return false;
+    }
+    //First use - try to attach (only time this locks)
+    QMutexLocker lock(&mutex);
+    if(!tried.load()) {
+        data.store(attach(false), std::memory_order_release);
+        tried.store(true);
+    }
+    return (data.load(std::memory_order_acquire)!=0);
+}
+
+QImage LIconSharedCache::find(QString theme, QString name, int size, int scale) {
+    if(!isAttached()) {
+        return QImage();
+    }
+    QByteArray key = entryKey(theme, name, size, scale);
+    if(key.length() >= SHM_KEY_SIZE) {
+        return QImage();
+    }
+    uchar *base = data.load(std::memory_order_acquire);
+    shm_entry *table = (shm_entry*) (base+SHM_TABLE_OFFSET);
+    quint32 hash = qHash(key);
+    for(int i=0; i<SHM_MAX_PROBES; i++) {
+        shm_entry *entry = &table[(hash+i) % SHM_ENTRIES];
+        quint32 seq = entry->seq.load(std::memory_order_acquire);
+        if(seq & 1) {
+            continue;    //being written right now
+        }
+        if(entry->valid==0) {
+            return QImage();    //end of the probe chain
+        }
+        if(entry->hash!=hash || strncmp(entry->key, key.constData(), SHM_KEY_SIZE)!=0) {
+            continue;
+        }
+        //Read the entry once - the writer could be changing it under us, so check everything before touching the pixels
+        quint64 offset = entry->offset;
+        quint32 width = entry->width;
+        quint32 height = entry->height;
+        quint32 bpl = entry->bytesPerLine;
+        quint32 iscale = entry->scale;
+        quint64 bytes = ((quint64) bpl)*height;
+        if(width==0 || height==0 || width>SHM_MAX_DIM || height>SHM_MAX_DIM || bpl < ((quint64) width)*4 || bytes > SHM_ARENA_SIZE || offset > SHM_ARENA_SIZE-bytes) {
+            return QImage();
+        }
+        QImage img = QImage(base+SHM_ARENA_OFFSET+offset, width, height, bpl, QImage::Format_ARGB32_Premultiplied).copy();
+        //Make sure the entry did not get rewritten while copying it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(entry->seq.load(std::memory_order_relaxed)!=seq) {
+            return QImage();
+        }
+        img.setDevicePixelRatio(qMax((quint32) 1, iscale));
+        return img;
+    }
+    return QImage();
+}
+
+void LIconSharedCache::insert(QString theme, QString name, int size, int scale, QImage img) {
+    if(!writer.load() || img.isNull()) {
+        return;
+    }
+    QMutexLocker lock(&mutex);
+    QByteArray key = entryKey(theme, name, size, scale);
+    if(key.length() >= SHM_KEY_SIZE || img.width()>SHM_MAX_DIM || img.height()>SHM_MAX_DIM) {
+        return;
+    }
+    if(generation!=LIconThemeIndex::instance()->generation()) {
+        //Icon theme was re-read since the current entries were made
+        generation = LIconThemeIndex::instance()->generation();
+        reset();
+    }
+    img = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    quint64 bytes = ((quint64) img.bytesPerLine())*img.height();
+    bytes = (bytes+63) & ~((quint64) 63);
+    if(bytes > SHM_ARENA_SIZE/16) {
+        return;    //not worth taking that much of the space
+    }
+    uchar *base = data.load();
+    shm_header *header = (shm_header*) base;
+    shm_entry *table = (shm_entry*) (base+SHM_TABLE_OFFSET);
+    if(header->used.load(std::memory_order_relaxed)+bytes > header->arenasize) {
+        reset();    //full - start over
+    }
+    quint32 hash = qHash(key);
+    shm_entry *entry = 0;
+    for(int i=0; i<SHM_MAX_PROBES && entry==0; i++) {
+        shm_entry *tmp = &table[(hash+i) % SHM_ENTRIES];
+        if(tmp->valid==0) {
+            entry = tmp;
+        }
+        else if(tmp->hash==hash && strncmp(tmp->key, key.constData(), SHM_KEY_SIZE)==0) {
+            return;    //already there
+        }
+    }
+    if(entry==0) {
+        reset();    //probe chain full
+        entry = &table[hash % SHM_ENTRIES];
+    }
+    quint64 offset = header->used.fetch_add(bytes, std::memory_order_relaxed);
+    //Odd sequence number while writing, then publish with the next even number
+    quint32 seq = entry->seq.load(std::memory_order_relaxed);
+    entry->seq.store(seq+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(base+SHM_ARENA_OFFSET+offset, img.constBits(), img.bytesPerLine()*img.height());
+    entry->hash = hash;
+    entry->width = img.width();
+    entry->height = img.height();
+    entry->bytesPerLine = img.bytesPerLine();
+    entry->offset = offset;
+    entry->scale = scale;
+    memset(entry->key, 0, SHM_KEY_SIZE);
+    memcpy(entry->key, key.constData(), key.length());
+    entry->valid = 1;
+    entry->seq.store(seq+2, std::memory_order_release);
+}
+
+void LIconSharedCache::clear() {
+    if(!writer.load()) {
+        return;
+    }
+    QMutexLocker lock(&mutex);
+    generation = LIconThemeIndex::instance()->generation();
+    reset();
+}
+
+QIcon LIconSharedCache::themeIcon(QString name, QIcon icon) {
+    if(icon.isNull() || name.isEmpty() || !instance()->isAttached()) {
+        return icon;
+    }
+    return QIcon(new LSharedIconEngine(name, icon));
+}
+
+// === PRIVATE ===
+uchar* LIconSharedCache::attach(bool write) {
+    int fd = shm_open(segmentName().constData(), (write ? (O_RDWR | O_CREAT) : O_RDONLY) | O_CLOEXEC, 0600);
+    if(fd<0) {
+        return 0;
+    }
+    struct stat info;
+    //Only ever use a segment this user made (anybody can create a name under /dev/shm first)
+    if(fstat(fd, &info)!=0 || info.st_uid!=getuid() || (info.st_mode & 0777)!=0600 || (!write && (quint64) info.st_size < SHM_TOTAL_SIZE) ) {
+        ::close(fd);
+        return 0;
+    }
+    bool fresh = ((quint64) info.st_size != SHM_TOTAL_SIZE);
+    if(write && fresh && ftruncate(fd, SHM_TOTAL_SIZE)!=0) {
+        ::close(fd);
+        return 0;
+    }
+    void *map = mmap(0, SHM_TOTAL_SIZE, write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map==MAP_FAILED) {
+        return 0;
+    }
+    uchar *base = (uchar*) map;
+    shm_header *header = (shm_header*) base;
+    bool valid = (header->magic==SHM_MAGIC && header->version==SHM_VERSION && header->entries==SHM_ENTRIES && header->keysize==SHM_KEY_SIZE && header->arenasize==SHM_ARENA_SIZE);
+    if(write && (fresh || !valid)) {
+        //New segment (or one from a different version) - set it up from scratch
+        memset(base, 0, SHM_ARENA_OFFSET);
+        header = new (base) shm_header;
+        header->entries = SHM_ENTRIES;
+        header->keysize = SHM_KEY_SIZE;
+        header->arenasize = SHM_ARENA_SIZE;
+        header->used.store(0);
+        header->resets.store(0);
+        header->version = SHM_VERSION;
+        header->magic = SHM_MAGIC;
+        valid = true;
+    }
+    if(!valid) {
+        munmap(base, SHM_TOTAL_SIZE);
+        return 0;
+    }
+    return base;
+}
+
+void LIconSharedCache::reset() {
+    //mutex must already be locked (writer only)
+    uchar *base = data.load();
+    shm_header *header = (shm_header*) base;
+    shm_entry *table = (shm_entry*) (base+SHM_TABLE_OFFSET);
+    for(int i=0; i<SHM_ENTRIES; i++) {
+        if(table[i].valid==0) {
+            continue;
+        }
+        //Bump the sequence number so any reader in the middle of a copy throws it away
+        quint32 seq = table[i].seq.load(std::memory_order_relaxed);
+        table[i].seq.store(seq+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        table[i].valid = 0;
+        table[i].seq.store(seq+2, std::memory_order_release);
+    }
+    header->used.store(0, std::memory_order_release);
+    header->resets.fetch_add(1, std::memory_order_relaxed);
+}
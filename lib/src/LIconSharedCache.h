@@ -0,0 +1,63 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a raster cache for theme icons which is shared between all the
+//  7b7b processes for the current user (POSIX shared memory segment).
+//  The desktop session is the only writer: every themed icon it renders gets
+//  copied into the segment, keyed by (theme, name, size, scale), and the other
+//  tools just attach read-only and copy the pixels back out.
+//  Slots are handed out with atomics only (bump allocator for the pixel data,
+//  a sequence number per entry so readers can detect a slot being rewritten)
+//  so readers never have to wait on the writer. The writer starts over from
+//  empty when the segment fills up, when a session starts and whenever the
+//  icon theme gets re-read. Segments which were not created by this user are ignored.
+//===========================================
+#ifndef _LUMINA_LIBRARY_ICON_SHARED_CACHE_H
+#define _LUMINA_LIBRARY_ICON_SHARED_CACHE_H
+
+#include <QIcon>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+
+class LIconSharedCache {
+public:
+    static LIconSharedCache* instance();
+
+    //Create (or re-use) the segment and become the writer (desktop session only - starts out empty)
+    bool openWriter();
+    bool isAttached(); //(tries to attach read-only the first time)
+    bool isWriter() {
+        return writer.load();
+    }
+
+    //Copy of the cached image (null if not cached)
+    QImage find(QString theme, QString name, int size, int scale);
+    //Add an image (ignored unless this process is the writer)
+    void insert(QString theme, QString name, int size, int scale, QImage img);
+    //Drop all the entries (writer only - use when the icon theme changes)
+    void clear();
+
+    //Icon which gets its pixmaps out of the shared cache (and fills it in the writer process)
+    // Returns the input icon as-is when there is no shared cache around
+    static QIcon themeIcon(QString name, QIcon icon);
+
+private:
+    LIconSharedCache();
+    ~LIconSharedCache();
+
+    QMutex mutex; //attaching and writing (find() only locks for the first attach)
+    std::atomic<uchar*> data; //mapped segment (0 until attached)
+    uchar *oldmap; //read-only mapping from before openWriter() (left mapped for readers still using it)
+    std::atomic<bool> writer, tried;
+    quint32 generation; //LIconThemeIndex generation the entries were made with (writer only)
+
+    static uchar* attach(bool write);
+    void reset(); //writer only - drop all the entries
+};
+
+#endif
@@ -0,0 +1,530 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LIconThemeIndex.h"
+#include "LuminaOS.h"
+#include "LUtils.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+#define CACHE_MAGIC 0x37626974 //"7bit"
+#define CACHE_VERSION 1
+#define BASE_THEME "material-design-light" //7b7b base icon set
+#define FALLBACK_THEME "hicolor" //XDG fallback (apps add to this)
+
+//Sections of an index.theme file (<section> -> <key> -> <value>)
+static QHash<QString, QHash<QString, QString> > readIndexTheme(QString path) {
+    QHash<QString, QHash<QString, QString> > out;
+    QStringList lines = LUtils::readFile(path);
+    QString section;
+    for(int i=0; i<lines.length(); i++) {
+        QString line = lines[i].trimmed();
+        if(line.isEmpty() || line.startsWith("#")) {
+            continue;
+        }
+        if(line.startsWith("[") && line.endsWith("]")) {
+            section = line.mid(1, line.length()-2);
+        }
+        else if(line.contains("=") && !section.isEmpty()) {
+            out[section].insert(line.section("=",0,0).trimmed(), line.section("=",1,-1).trimmed());
+        }
+    }
+    return out;
+}
+
+//Base dirs which might contain icon themes (highest priority first)
+static QStringList iconBaseDirs() {
+    QStringList paths;
+    paths << QDir::homePath()+"/.icons/";
+    QStringList xdd = QString(getenv("XDG_DATA_HOME")).split(":");
+    xdd << QString(getenv("XDG_DATA_DIRS")).split(":");
+    for(int i=0; i<xdd.length(); i++) {
+        if(!xdd[i].isEmpty() && QFile::exists(xdd[i]+"/icons") && !paths.contains(xdd[i]+"/icons/")) {
+            paths << xdd[i]+"/icons/";
+        }
+    }
+    return paths;
+}
+
+LIconThemeIndex* LIconThemeIndex::instance() {
+    static LIconThemeIndex *INDEX = 0;
+    static QMutex initmutex;
+    QMutexLocker lock(&initmutex);
+    if(INDEX==0) {
+        INDEX = new LIconThemeIndex();
+    }
+    return INDEX;
+}
+
+LIconThemeIndex::LIconThemeIndex() {
+
+}
+
+void LIconThemeIndex::setTheme(QString theme) {
+    QMutexLocker lock(&mutex);
+    if(theme==current && !sources.isEmpty()) {
+        return;
+    }
+    current = theme;
+    checkForChanges(true);
+}
+
+QString LIconThemeIndex::theme() {
+    QMutexLocker lock(&mutex);
+    return current;
+}
+
+void LIconThemeIndex::reload() {
+    QMutexLocker lock(&mutex);
+    checkForChanges(false);
+}
+
+QString LIconThemeIndex::find(QString name, int size, int scale) {
+    if(name.isEmpty()) {
+        return "";
+    }
+    scale = qMax(1, scale);
+    QString key = (size>0) ? name+"@"+QString::number(size)+"x"+QString::number(scale) : name;
+    QMutexLocker lock(&mutex);
+    if(resolved.contains(key)) {
+        return resolved.value(key);
+    }
+    QString path;
+    QList<quint32> entries = icons.value(name);
+    //Only the highest-priority theme which has a usable file gets looked at
+    for(int first=0; first<entries.length() && path.isEmpty(); ) {
+        int level = dirs[entries[first]>>8].level;
+        int last = first;
+        while(last<entries.length() && dirs[entries[last]>>8].level==level) {
+            last++;
+        }
+        int best = -1;
+        quint8 besttype = 0;
+        int bestdist = 0;
+        for(int i=first; i<last; i++) {
+            const icon_dir &dir = dirs[entries[i]>>8];
+            quint8 types = entries[i] & 0xFF;
+            if(name.contains("libreoffice")) {
+                types &= ~FILE_SVG;    //those SVGs do not render properly
+            }
+            if(types==0) {
+                continue;
+            }
+            if(size<=0) {
+                //No size requested: scalable version first, then the largest bitmap
+                if(types & FILE_SVG) {
+                    if(!(besttype & FILE_SVG)) {
+                        best = i;
+                        besttype = FILE_SVG;
+                    }
+                }
+                else if(!(besttype & FILE_SVG) && (best<0 || dir.size*dir.scale > dirs[entries[best]>>8].size*dirs[entries[best]>>8].scale) ) {
+                    best = i;
+                    besttype = types;
+                }
+                continue;
+            }
+            //Spec lookup: first dir which matches the size exactly, otherwise the closest one
+            if(matchesSize(dir, size, scale)) {
+                best = i;
+                besttype = types;
+                break;
+            }
+            int dist = sizeDistance(dir, size, scale);
+            if(best<0 || dist<bestdist) {
+                best = i;
+                besttype = types;
+                bestdist = dist;
+            }
+        }
+        if(best>=0) {
+            //File type preference from the spec: png, svg, xpm
+            QString ext;
+            if( (besttype & FILE_PNG) && !(size<=0 && (besttype & FILE_SVG)) ) {
+                ext = ".png";
+            }
+            else if(besttype & FILE_SVG) {
+                ext = ".svg";
+            }
+            else {
+                ext = ".xpm";
+            }
+            path = dirs[entries[best]>>8].path+"/"+name+ext;
+        }
+        first = last;
+    }
+    if(path.isEmpty()) {
+        path = pixmaps.value(name); //last resort
+    }
+    resolved.insert(key, path);
+    return path;
+}
+
+// === PRIVATE ===
+void LIconThemeIndex::checkForChanges(bool force) {
+    if(current.isEmpty()) {
+        return;
+    }
+    //Look at what is there now (stats only)
+    QStringList bases = iconBaseDirs();
+    QStringList srcs;
+    QList<theme_root> roots;
+    QList<icon_dir> found = scanDirs(themeChain(current, bases), bases, srcs, roots);
+    QString pixdir = LOS::AppPrefix()+"share/pixmaps";
+    QFileInfo pixinfo(pixdir);
+    srcs << pixdir+":"+QString::number(pixinfo.lastModified().toMSecsSinceEpoch());
+    if(!force && srcs==sources) {
+        return;    //nothing changed
+    }
+    sources = srcs;
+    dirs = found;
+    gen.fetchAndAddRelaxed(1);
+    icons.clear();
+    pixmaps.clear();
+    resolved.clear();
+    QString cachefile = QString(getenv("XDG_CACHE_HOME")).section(":",0,0);
+    if(cachefile.isEmpty()) {
+        cachefile = QDir::homePath()+"/.cache";
+    }
+    cachefile.append("/7b7b");
+    if(!QFile::exists(cachefile)) {
+        QDir D;
+        D.mkpath(cachefile);
+    }
+    cachefile.append("/icontheme-"+QString(current).replace("/","_")+".cache");
+    if(loadCache(cachefile, srcs)) {
+        return;
+    }
+    //Build the index: one directory listing per icon dir (or the icon-theme.cache for the whole theme dir)
+    for(int i=0; i<roots.length(); i++) {
+        if(readIconCache(roots[i])) {
+            continue;
+        }
+        QList<int> nums = roots[i].subdirs.values();
+        std::sort(nums.begin(), nums.end());
+        for(int j=0; j<nums.length(); j++) {
+            readDir(nums[j]);
+        }
+    }
+    QStringList formats = LUtils::imageExtensions();
+    QStringList files = QDir(pixdir).entryList(QDir::Files, QDir::Name);
+    for(int i=0; i<files.length(); i++) {
+        QString path = pixdir+"/"+files[i];
+        if(!pixmaps.contains(files[i])) {
+            pixmaps.insert(files[i], path);
+        }
+        if(files[i].contains(".") && formats.contains(files[i].section(".",-1).toLower()) && !pixmaps.contains(files[i].section(".",0,-2)) ) {
+            pixmaps.insert(files[i].section(".",0,-2), path);
+        }
+    }
+    saveCache(cachefile);
+}
+
+QStringList LIconThemeIndex::themeChain(QString theme, QStringList bases) {
+    QStringList chain;
+    QStringList todo;
+    todo << theme;
+    while(!todo.isEmpty()) {
+        QString name = todo.takeFirst();
+        if(name.isEmpty() || name==FALLBACK_THEME || chain.contains(name)) {
+            continue;    //hicolor always goes last
+        }
+        chain << name;
+        //Parent themes come from the first index.theme file for this theme (depth-first)
+        for(int i=0; i<bases.length(); i++) {
+            if(QFile::exists(bases[i]+name+"/index.theme")) {
+                QString inherits = readIndexTheme(bases[i]+name+"/index.theme").value("Icon Theme").value("Inherits");
+                QStringList parents = inherits.replace(";",",").split(",", Qt::SkipEmptyParts);
+                for(int j=parents.length()-1; j>=0; j--) {
+                    todo.prepend(parents[j].trimmed());
+                }
+                break;
+            }
+        }
+    }
+    if(!chain.contains(BASE_THEME)) {
+        chain << BASE_THEME;
+    }
+    chain << FALLBACK_THEME;
+    return chain;
+}
+
+QList<LIconThemeIndex::icon_dir> LIconThemeIndex::scanDirs(QStringList chain, QStringList bases, QStringList &srcs, QList<theme_root> &roots) {
+    QList<icon_dir> out;
+    for(int level=0; level<chain.length(); level++) {
+        //The first index.theme file for the theme lists the dirs for all the base dirs
+        QHash<QString, QHash<QString, QString> > index;
+        for(int i=0; i<bases.length(); i++) {
+            QFileInfo info(bases[i]+chain[level]+"/index.theme");
+            if(info.exists()) {
+                index = readIndexTheme(info.absoluteFilePath());
+                srcs << info.absoluteFilePath()+":"+QString::number(info.lastModified().toMSecsSinceEpoch());
+                break;
+            }
+        }
+        QStringList subdirs = index.value("Icon Theme").value("Directories").split(",", Qt::SkipEmptyParts);
+        subdirs << index.value("Icon Theme").value("ScaledDirectories").split(",", Qt::SkipEmptyParts);
+        subdirs.removeDuplicates();
+        for(int i=0; i<bases.length(); i++) {
+            QFileInfo rootinfo(bases[i]+chain[level]);
+            if(!rootinfo.isDir()) {
+                continue;
+            }
+            theme_root root;
+            root.path = rootinfo.absoluteFilePath();
+            root.newest = rootinfo.lastModified().toMSecsSinceEpoch();
+            srcs << root.path+":"+QString::number(root.newest);
+            for(int j=0; j<subdirs.length(); j++) {
+                QString sub = subdirs[j].trimmed();
+                QFileInfo info(root.path+"/"+sub);
+                if(sub.isEmpty() || !info.isDir()) {
+                    continue;
+                }
+                QHash<QString, QString> keys = index.value(sub);
+                icon_dir dir;
+                dir.path = info.absoluteFilePath();
+                dir.level = qMin(level, 255);
+                dir.size = keys.value("Size").toUShort();
+                dir.scale = qMax(1, keys.value("Scale","1").toInt());
+                dir.minsize = keys.value("MinSize", QString::number(dir.size)).toUShort();
+                dir.maxsize = keys.value("MaxSize", QString::number(dir.size)).toUShort();
+                dir.threshold = keys.value("Threshold","2").toUShort();
+                QString type = keys.value("Type","Threshold");
+                if(type=="Fixed") {
+                    dir.type = DIR_FIXED;
+                }
+                else if(type=="Scalable") {
+                    dir.type = DIR_SCALABLE;
+                }
+                else {
+                    dir.type = DIR_THRESHOLD;
+                }
+                qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+                root.newest = qMax(root.newest, mtime);
+                srcs << dir.path+":"+QString::number(mtime);
+                root.subdirs.insert(sub, out.length());
+                out << dir;
+            }
+            roots << root;
+        }
+    }
+    return out;
+}
+
+//DirectoryMatchesSize() from the icon theme spec
+bool LIconThemeIndex::matchesSize(const icon_dir &dir, int size, int scale) {
+    if(dir.scale!=scale) {
+        return false;
+    }
+    switch(dir.type) {
+    case DIR_FIXED:
+        return (dir.size==size);
+    case DIR_SCALABLE:
+        return (dir.minsize<=size && size<=dir.maxsize);
+    default:
+        return (dir.size-dir.threshold<=size && size<=dir.size+dir.threshold);
+    }
+}
+
+//DirectorySizeDistance() from the icon theme spec (in device pixels)
+int LIconThemeIndex::sizeDistance(const icon_dir &dir, int size, int scale) {
+    int want = size*scale;
+    switch(dir.type) {
+    case DIR_FIXED:
+        return qAbs(dir.size*dir.scale - want);
+    case DIR_SCALABLE:
+        if(want < dir.minsize*dir.scale) {
+            return dir.minsize*dir.scale - want;
+        }
+        if(want > dir.maxsize*dir.scale) {
+            return want - dir.maxsize*dir.scale;
+        }
+        return 0;
+    default:
+        if(want < (dir.size-dir.threshold)*dir.scale) {
+            return dir.minsize*dir.scale - want;
+        }
+        if(want > (dir.size+dir.threshold)*dir.scale) {
+            return want - dir.maxsize*dir.scale;
+        }
+        return 0;
+    }
+}
+
+void LIconThemeIndex::readDir(int dir) {
+    QStringList files = QDir(dirs[dir].path).entryList(QStringList() << "*.png" << "*.svg" << "*.xpm", QDir::Files, QDir::NoSort);
+    for(int i=0; i<files.length(); i++) {
+        addFile(files[i], dir);
+    }
+}
+
+//The icon-theme.cache format is the one written by gtk-update-icon-cache (big-endian, offsets from the start of the file)
+bool LIconThemeIndex::readIconCache(const theme_root &root) {
+    QFile file(root.path+"/icon-theme.cache");
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    if(QFileInfo(file).lastModified().toMSecsSinceEpoch() < root.newest) {
+        return false;    //stale cache - icons were added/removed after it was written
+    }
+    qint64 size = file.size();
+    const uchar *data = (size>=12 && size<=0xFFFFFFFF) ? file.map(0, size) : 0;
+    if(data==0) {
+        return false;
+    }
+    auto card16 = [&](quint32 off) -> quint32 {
+        return (off+2<=size) ? qFromBigEndian<quint16>(data+off) : 0;
+    };
+    auto card32 = [&](quint32 off) -> quint32 {
+        return (off+4<=size) ? qFromBigEndian<quint32>(data+off) : 0xFFFFFFFF;
+    };
+    auto string = [&](quint32 off) -> QString {
+        if(off>=size || memchr(data+off, 0, size-off)==0) {
+            return "";
+        }
+        return QString::fromUtf8((const char*) (data+off));
+    };
+    if(card16(0)!=1 || card16(2)!=0) {
+        file.unmap(const_cast<uchar*>(data));
+        return false;    //unknown version
+    }
+    quint32 hashOffset = card32(4);
+    quint32 dirListOffset = card32(8);
+    //Map the cache dir numbers to ours (dirs which are not in index.theme get skipped)
+    quint32 ndirs = card32(dirListOffset);
+    if(ndirs==0xFFFFFFFF || ndirs>0xFFFF) {
+        file.unmap(const_cast<uchar*>(data));
+        return false;
+    }
+    QList<int> dirmap;
+    for(quint32 i=0; i<ndirs; i++) {
+        dirmap << root.subdirs.value(string(card32(dirListOffset+4+4*i)), -1);
+    }
+    quint32 nbuckets = card32(hashOffset);
+    if(nbuckets==0xFFFFFFFF) {
+        file.unmap(const_cast<uchar*>(data));
+        return false;
+    }
+    for(quint32 b=0; b<nbuckets; b++) {
+        quint32 entry = card32(hashOffset+4+4*b);
+        for(int guard=0; entry!=0xFFFFFFFF && guard<100000; guard++) {
+            QString name = string(card32(entry+4));
+            quint32 images = card32(entry+8);
+            quint32 nimages = card32(images);
+            for(quint32 i=0; i<nimages && nimages!=0xFFFFFFFF; i++) {
+                quint32 dir = card16(images+4+8*i);
+                quint32 flags = card16(images+4+8*i+2);
+                if(dir>=ndirs || dirmap[dir]<0) {
+                    continue;
+                }
+                //Cache flags: 0x1 xpm, 0x2 svg, 0x4 png
+                quint8 types = 0;
+                if(flags & 0x1) {
+                    types |= FILE_XPM;
+                }
+                if(flags & 0x2) {
+                    types |= FILE_SVG;
+                }
+                if(flags & 0x4) {
+                    types |= FILE_PNG;
+                }
+                if(types==0 || name.isEmpty()) {
+                    continue;
+                }
+                QList<quint32> &list = icons[name];
+                quint32 key = (quint32) dirmap[dir] << 8;
+                //Keep the list in dir order (priority order)
+                int pos = list.length();
+                while(pos>0 && (list[pos-1]>>8) > (key>>8)) {
+                    pos--;
+                }
+                if(pos>0 && (list[pos-1]>>8)==(key>>8)) {
+                    list[pos-1] |= types;
+                }
+                else {
+                    list.insert(pos, key | types);
+                }
+            }
+            entry = card32(entry);
+        }
+    }
+    file.unmap(const_cast<uchar*>(data));
+    return true;
+}
+
+void LIconThemeIndex::addFile(QString file, int dir) {
+    quint8 type = 0;
+    if(file.endsWith(".png")) {
+        type = FILE_PNG;
+    }
+    else if(file.endsWith(".svg")) {
+        type = FILE_SVG;
+    }
+    else if(file.endsWith(".xpm")) {
+        type = FILE_XPM;
+    }
+    else {
+        return;
+    }
+    QList<quint32> &list = icons[file.left(file.length()-4)];
+    //Dirs get read in order - the same dir can only be the last entry
+    if(!list.isEmpty() && (list.last()>>8)==(quint32) dir) {
+        list.last() |= type;
+    }
+    else {
+        list << ( ((quint32) dir << 8) | type );
+    }
+}
+
+bool LIconThemeIndex::loadCache(QString file, const QStringList &srcs) {
+    QFile cache(file);
+    if(!cache.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&cache);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version;
+    QString ctheme;
+    QStringList csources;
+    in >> magic >> version;
+    if(in.status()!=QDataStream::Ok || magic!=CACHE_MAGIC || version!=CACHE_VERSION) {
+        return false;
+    }
+    in >> ctheme >> csources;
+    if(ctheme!=current || csources!=srcs) {
+        return false;    //stale
+    }
+    //The dirs were just scanned (same sources) - only the icon tables are needed
+    in >> icons >> pixmaps;
+    if(in.status()!=QDataStream::Ok) {
+        icons.clear();
+        pixmaps.clear();
+        return false;
+    }
+    return true;
+}
+
+void LIconThemeIndex::saveCache(QString file) {
+    QSaveFile cache(file);
+    if(!cache.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream out(&cache);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << (quint32) CACHE_MAGIC << (quint32) CACHE_VERSION << current << sources << icons << pixmaps;
+    if(out.status()!=QDataStream::Ok) {
+        cache.cancelWriting();
+        return;
+    }
+    cache.commit();
+}
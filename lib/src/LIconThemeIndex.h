@@ -0,0 +1,84 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is an index of all the icon files in the current icon theme
+//  The theme, everything it inherits, the 7b7b base set and hicolor are read
+//  once (from the index.theme "Directories" lists) into a single
+//  name -> (directory, file type) table, with share/pixmaps as the last resort.
+//  Existing icon-theme.cache files are used instead of listing the directories
+//  when they are up to date, and the finished table is kept in
+//  $XDG_CACHE_HOME/7b7b/ until one of the directories changes.
+//  Looking up an icon name never touches the filesystem.
+//===========================================
+#ifndef _LUMINA_LIBRARY_ICON_THEME_INDEX_H
+#define _LUMINA_LIBRARY_ICON_THEME_INDEX_H
+
+#include <QAtomicInteger>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class LIconThemeIndex {
+public:
+    static LIconThemeIndex* instance();
+
+    //Switch to a different theme (loads/builds the index as needed)
+    void setTheme(QString theme);
+    QString theme();
+    //Check the theme dirs for changes and rebuild the index if needed
+    void reload();
+
+    //Full path of the file to use for an icon name (empty if the theme does not have it)
+    // With a size (logical pixels) and scale the closest match is picked as described in the icon theme spec,
+    // otherwise the scalable/largest version is used.
+    QString find(QString name, int size = 0, int scale = 1);
+    //Changes every time the index gets rebuilt (or switched to another theme)
+    quint32 generation() {
+        return gen.loadRelaxed();
+    }
+
+private:
+    LIconThemeIndex();
+
+    enum DirType {DIR_FIXED, DIR_SCALABLE, DIR_THRESHOLD};
+    enum FileType {FILE_PNG = 0x1, FILE_SVG = 0x2, FILE_XPM = 0x4};
+    struct icon_dir {
+        QString path;
+        quint8 level; //position of the theme in the inheritance chain (0 = current theme)
+        quint8 type; //DirType
+        quint16 size, scale, minsize, maxsize, threshold;
+    };
+    //Theme directory in one of the base dirs (only used while building the index)
+    struct theme_root {
+        QString path;
+        QHash<QString, int> subdirs; //<subdir> -> <dir number>
+        qint64 newest; //latest mtime of the dir and all its subdirs
+    };
+
+    QMutex mutex;
+    QString current; //theme the index is for
+    QStringList sources; //"<dir>:<mtime>" for all the dirs which went into the index
+    QList<icon_dir> dirs;
+    QHash<QString, QList<quint32> > icons; //icon name -> list of (<dir number> << 8 | <FileType flags>), in theme order
+    QHash<QString, QString> pixmaps; //share/pixmaps files by name (with and without the extension)
+    QHash<QString, QString> resolved; //lookups done so far (including the misses)
+    QAtomicInteger<quint32> gen;
+
+    void checkForChanges(bool force); //mutex must already be locked
+    QStringList themeChain(QString theme, QStringList bases);
+    //Find all the icon dirs (stats only, nothing gets listed)
+    QList<icon_dir> scanDirs(QStringList chain, QStringList bases, QStringList &srcs, QList<theme_root> &roots);
+    static bool matchesSize(const icon_dir &dir, int size, int scale);
+    static int sizeDistance(const icon_dir &dir, int size, int scale);
+    void readDir(int dir);
+    bool readIconCache(const theme_root &root);
+    void addFile(QString file, int dir);
+    bool loadCache(QString file, const QStringList &srcs);
+    void saveCache(QString file);
+};
+
+#endif
@@ -0,0 +1,416 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LMimeApps.h"
+#include "LUtils.h"
+#include "LuminaXDG.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define DEFAULTS_SECTION "[Default Applications]"
+
+#define WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#define EVENT_RELOAD 1 //one of the watched files (or dirs) changed
+#define EVENT_APPS 2 //something changed next to one of the resolved apps
+
+//Non-blocking read of all pending events
+//  EVENT_RELOAD: file with one of the suffixes, the watched dir itself, or the next entry on the way to a missing dir
+//  EVENT_APPS: any entry in one of the app dirs, or a *.desktop file anywhere else
+static int pendingEvents(int fd, const QList<QByteArray> &suffixes, const QHash<int, QStringList> &missing, const QSet<int> &appdirs = QSet<int>()) {
+    int found = 0;
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while( (len = ::read(fd, buf, sizeof(buf))) > 0 ) {
+        for(char *ptr = buf; ptr < buf+len; ptr += sizeof(struct inotify_event) + ((struct inotify_event*) ptr)->len) {
+            struct inotify_event *ev = (struct inotify_event*) ptr;
+            if(ev->len==0 || (ev->mask & IN_Q_OVERFLOW)) {
+                found |= EVENT_RELOAD;
+                continue;
+            }
+            QByteArray name(ev->name);
+            if(missing.contains(ev->wd) && missing.value(ev->wd).contains(QString::fromLocal8Bit(name))) {
+                found |= EVENT_RELOAD;
+                continue;
+            }
+            for(int i=0; i<suffixes.length() && !(found & EVENT_RELOAD); i++) {
+                if(name.endsWith(suffixes[i])) {
+                    found |= EVENT_RELOAD;
+                }
+            }
+            if(appdirs.contains(ev->wd) || name.endsWith(".desktop")) {
+                found |= EVENT_APPS;
+            }
+        }
+    }
+    return found;
+}
+
+//Watch a dir (same events for every watch, since watches on the same dir share one descriptor)
+// A missing dir gets a watch on the closest existing parent instead, with the entry in it which
+// leads to the dir noted in "missing". Returns false if nothing could be watched.
+static bool watchDir(int fd, QString dir, QHash<int, QStringList> &missing) {
+    if(dir.isEmpty()) {
+        dir = "/";
+    }
+    QString next;
+    if(dir.startsWith("/") && !QFileInfo(dir).isDir()) {
+        QString parent = dir.section("/",0,-2);
+        while(!parent.isEmpty() && !QFileInfo(parent).isDir()) {
+            parent = parent.section("/",0,-2);
+        }
+        next = dir.mid(parent.length()+1).section("/",0,0,QString::SectionSkipEmpty);
+        dir = parent.isEmpty() ? QString("/") : parent;
+    }
+    int wd = inotify_add_watch(fd, dir.toLocal8Bit().constData(), WATCH_EVENTS);
+    if(wd<0) {
+        return false;    //relative dir (or out of watches)
+    }
+    if(!next.isEmpty() && !missing.value(wd).contains(next)) {
+        missing[wd] << next;
+    }
+    return true;
+}
+
+LMimeApps* LMimeApps::instance() {
+    static LMimeApps *MIMEAPPS = 0;
+    static QMutex initmutex;
+    QMutexLocker lock(&initmutex);
+    if(MIMEAPPS==0) {
+        MIMEAPPS = new LMimeApps();
+    }
+    return MIMEAPPS;
+}
+
+LMimeApps::LMimeApps() {
+    inotifyFD = -1;
+    gen = 0;
+    unwatched = false;
+    forceRead = true;
+    infoFD = -1;
+    infoUnwatched = false;
+    infoRead = true;
+    infoGen = 0;
+    resolvedInfo = 0;
+}
+
+LMimeApps::~LMimeApps() {
+    if(inotifyFD>=0) {
+        ::close(inotifyFD);
+    }
+    if(infoFD>=0) {
+        ::close(infoFD);
+    }
+}
+
+QString LMimeApps::defaultApp(QString mime) {
+    QMutexLocker lock(&mutex);
+    checkForChanges();
+    //Apps coming and going in the app dirs (the mimeinfo.cache watches) invalidate the results too
+    checkInfoChanges();
+    if(resolvedInfo != infoGen) {
+        resolved.clear();
+        resolvedInfo = infoGen;
+    }
+    QHash<QString, QString>::const_iterator it = resolved.constFind(mime);
+    if(it != resolved.constEnd()) {
+        return it.value();
+    }
+    QString app = resolve(mime);
+    resolved.insert(mime, app);
+    //Apps outside the app dirs (and the list dirs): watch their dir as well
+    QString dir = app.section("/",0,-2);
+    if(inotifyFD>=0 && !app.isEmpty() && !watchedDirs.contains(dir) && !infoDirs.contains(dir)) {
+        watchedDirs << dir;
+        int wd = inotify_add_watch(inotifyFD, dir.toLocal8Bit().constData(), WATCH_EVENTS);
+        if(wd>=0) {
+            appWatches << wd;
+        }
+    }
+    return app;
+}
+
+bool LMimeApps::setDefaultApps(const QHash<QString, QString> &defaults) {
+    if(defaults.isEmpty()) {
+        return true;
+    }
+    QMutexLocker lock(&mutex);
+    QString filepath = userFile();
+    QStringList cinfo = LUtils::readFile(filepath);
+    //If this is a new file, make sure to add the header appropriately
+    if(cinfo.isEmpty()) {
+        cinfo << "#Automatically generated with 7b7b-config" << "# DO NOT CHANGE MANUALLY";
+    }
+    //Find the section with the defaults (add it as needed)
+    int start = cinfo.indexOf(DEFAULTS_SECTION);
+    if(start<0) {
+        cinfo << DEFAULTS_SECTION;
+        start = cinfo.length()-1;
+    }
+    int end = start+1;
+    while(end<cinfo.length() && !cinfo[end].startsWith("[")) {
+        end++;
+    }
+    //Drop any trailing blank lines in the section so new entries stay together
+    while(end>start+1 && cinfo[end-1].trimmed().isEmpty()) {
+        end--;
+    }
+    //Update the existing entries
+    QHash<QString, QString> todo = defaults;
+    for(int i=start+1; i<end; i++) {
+        QString key = cinfo[i].section("=",0,0).trimmed();
+        if(!todo.contains(key)) {
+            continue;
+        }
+        QString app = todo.take(key);
+        if(app.isEmpty()) {
+            cinfo.removeAt(i);
+            i--;
+            end--;
+        }
+        else {
+            cinfo[i] = key+"="+app+";";
+        }
+    }
+    //Now add the new entries at the end of the section
+    QStringList mimes = todo.keys();
+    mimes.sort();
+    for(int i=0; i<mimes.length(); i++) {
+        if(todo.value(mimes[i]).isEmpty()) {
+            continue;
+        }
+        cinfo.insert(end, mimes[i]+"="+todo.value(mimes[i])+";");
+        end++;
+    }
+    //Write the new file in one go
+    QSaveFile file(filepath);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out << cinfo.join("\n") << "\n";
+    out.flush();
+    bool ok = file.commit();
+    forceRead = true; //do not wait for inotify to catch up with our own change
+    return ok;
+}
+
+QStringList LMimeApps::availableApps(QString mime) {
+    QMutexLocker lock(&mutex);
+    checkInfoChanges();
+    return available.value(mime);
+}
+
+quint64 LMimeApps::generation() {
+    QMutexLocker lock(&mutex);
+    checkForChanges();
+    return gen;
+}
+
+QString LMimeApps::userFile() {
+    return QString(getenv("XDG_CONFIG_HOME"))+"/7b7b-mimeapps.list";
+}
+
+// === PRIVATE ===
+void LMimeApps::checkForChanges() {
+    QByteArray env = QByteArray(getenv("XDG_CONFIG_HOME"))+"\n"+getenv("XDG_DATA_HOME")+"\n"+getenv("XDG_CONFIG_DIRS")+"\n"+getenv("XDG_DATA_DIRS");
+    bool dirty = forceRead || (envkey != env);
+    if(!dirty && unwatched && readTime.elapsed() > 5000) {
+        dirty = true;    //some dirs could not be watched - re-read every so often instead
+    }
+    //Only care about events for the list files themselves (the dirs are shared with lots of other files)
+    if(inotifyFD>=0) {
+        int events = pendingEvents(inotifyFD, QList<QByteArray>() << "mimeapps.list", missingWatches, appWatches);
+        if(events & EVENT_RELOAD) {
+            dirty = true;
+        } else if(events & EVENT_APPS) {
+            resolved.clear();    //one of the apps might be gone (or a better one showed up) - the lists are still fine
+        }
+    }
+    if(!dirty) {
+        return;
+    }
+    //Re-read all the files (closing the old descriptor drops all the old watches)
+    if(inotifyFD>=0) {
+        ::close(inotifyFD);
+    }
+    inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    envkey = env;
+    forceRead = false;
+    unwatched = (inotifyFD<0);
+    paths = candidatePaths();
+    files.clear();
+    resolved.clear();
+    watchedDirs.clear();
+    missingWatches.clear();
+    appWatches.clear();
+    for(int i=0; i<paths.length(); i++) {
+        QString dir = paths[i].section("/",0,-2);
+        //Watch before reading so nothing gets lost in between (the closest parent for missing dirs)
+        if(inotifyFD>=0 && !watchedDirs.contains(dir)) {
+            watchedDirs << dir;
+            if(!watchDir(inotifyFD, dir, missingWatches)) {
+                unwatched = true;    //out of watches
+            }
+        }
+        QStringList info = LUtils::readFile(paths[i]);
+        if(info.isEmpty()) {
+            continue;
+        }
+        list_file lfile;
+        lfile.workdir = dir;
+        bool indefaults = false;
+        for(int l=0; l<info.length(); l++) {
+            QString line = info[l].trimmed();
+            if(line.startsWith("[")) {
+                indefaults = (line == DEFAULTS_SECTION);
+                continue;
+            }
+            if(!indefaults || line.startsWith("#") || !line.contains("=")) {
+                continue;
+            }
+            QString key = line.section("=",0,0).trimmed();
+            QStringList apps = line.section("=",1,-1).split(";", Qt::SkipEmptyParts);
+            if(key.contains("*")) {
+                lfile.wildcards << qMakePair(QRegularExpression::fromWildcard(key, Qt::CaseSensitive), apps);
+            }
+            else if(!lfile.exact.contains(key)) {
+                lfile.exact.insert(key, apps); //first entry in a file wins
+            }
+        }
+        files << lfile;
+    }
+    readTime.start();
+    gen++;
+}
+
+void LMimeApps::checkInfoChanges() {
+    QByteArray env = QByteArray(getenv("XDG_DATA_HOME"))+"\n"+getenv("XDG_DATA_DIRS");
+    bool dirty = infoRead || (infoenv != env);
+    if(!dirty && infoUnwatched && infoTime.elapsed() > 5000) {
+        dirty = true;    //some dirs could not be watched - re-read every so often instead
+    }
+    //New/removed *.desktop files matter too (only existing files get listed)
+    if(infoFD>=0 && pendingEvents(infoFD, QList<QByteArray>() << "mimeinfo.cache" << ".desktop", infoMissing)) {
+        dirty = true;
+    }
+    if(!dirty) {
+        return;
+    }
+    if(infoFD>=0) {
+        ::close(infoFD);
+    }
+    infoFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    infoenv = env;
+    infoRead = false;
+    infoUnwatched = (infoFD<0);
+    infoGen++;
+    available.clear();
+    infoMissing.clear();
+    QStringList dirs = LXDG::systemApplicationDirs();
+    infoDirs = dirs;
+    //Application dirs which do not exist yet: watch for them getting created
+    QStringList data = QString(getenv("XDG_DATA_HOME")).split(":", Qt::SkipEmptyParts);
+    data << QString(getenv("XDG_DATA_DIRS")).split(":", Qt::SkipEmptyParts);
+    for(int i=0; i<data.length() && infoFD>=0; i++) {
+        if(!dirs.contains(data[i]+"/applications") && !watchDir(infoFD, data[i]+"/applications", infoMissing)) {
+            infoUnwatched = true;
+        }
+    }
+    for(int i=0; i<dirs.length(); i++) {
+        if(infoFD>=0 && !watchDir(infoFD, dirs[i], infoMissing)) {
+            infoUnwatched = true;
+        }
+        QStringList info = LUtils::readFile(dirs[i]+"/mimeinfo.cache");
+        if(info.isEmpty()) {
+            continue;
+        }
+        //List the dir once instead of checking every entry
+        QStringList list = QDir(dirs[i]).entryList(QStringList() << "*.desktop", QDir::Files | QDir::Hidden);
+        QSet<QString> present(list.begin(), list.end());
+        for(int l=0; l<info.length(); l++) {
+            if(info[l].startsWith("[") || !info[l].contains("=")) {
+                continue;
+            }
+            QString mime = info[l].section("=",0,0);
+            QStringList files = info[l].section("=",1,-1).split(";",Qt::SkipEmptyParts);
+            QStringList &out = available[mime];
+            for(int m=0; m<files.length(); m++) {
+                if(present.contains(files[m])) {
+                    out << dirs[i]+"/"+files[m];
+                } else if(files[m].contains("-")) { //kde4-<filename> -> kde4/<filename> (stupid KDE variations!!)
+                    files[m].replace("-","/");
+                    if(QFile::exists(dirs[i]+"/"+files[m])) {
+                        out << dirs[i]+"/"+files[m];
+                    }
+                }
+            }
+            if(out.isEmpty()) {
+                available.remove(mime);
+            }
+        }
+    }
+    infoTime.start();
+}
+
+QString LMimeApps::resolve(QString mime) {
+    //Go through all the files in order of priority until a default is found
+    for(int i=0; i<files.length(); i++) {
+        //Exact match first, then any wildcard matches in this file
+        QStringList white = files[i].exact.value(mime);
+        for(int w=0; w<files[i].wildcards.length(); w++) {
+            if(files[i].wildcards[w].first.match(mime).hasMatch()) {
+                white << files[i].wildcards[w].second;
+            }
+        }
+        for(int w=0; w<white.length(); w++) {
+            //First check for absolute paths to *.desktop file
+            if(white[w].startsWith("/")) {
+                if(QFile::exists(white[w])) {
+                    return white[w];
+                }
+                continue; //invalid file path
+            }
+            //Now check for relative paths to file (in current priority-ordered work dir)
+            if(QFile::exists(files[i].workdir+"/"+white[w])) {
+                return (files[i].workdir+"/"+white[w]);
+            }
+            //Now go through the XDG DATA dirs and see if the file is in there
+            QString path = LUtils::AppToAbsolute(white[w]);
+            if(QFile::exists(path)) {
+                return path;
+            }
+        }
+    }
+    return "";
+}
+
+QStringList LMimeApps::candidatePaths() {
+    //Priority-ordered list of default file locations
+    QStringList dirs;
+    dirs << QString(getenv("XDG_CONFIG_HOME"))+"/7b7b-mimeapps.list" \
+         << QString(getenv("XDG_DATA_HOME"))+"/applications/7b7b-mimeapps.list" \
+         << QString(getenv("XDG_CONFIG_HOME"))+"/mimeapps.list" \
+         << QString(getenv("XDG_DATA_HOME"))+"/applications/mimeapps.list";
+    QStringList tmp = QString(getenv("XDG_CONFIG_DIRS")).split(":");
+    for(int i=0; i<tmp.length(); i++) {
+        dirs << tmp[i]+"/7b7b-mimeapps.list";
+        dirs << tmp[i]+"/mimeapps.list";
+    }
+    tmp = QString(getenv("XDG_DATA_DIRS")).split(":");
+    for(int i=0; i<tmp.length(); i++) {
+        dirs << tmp[i]+"/applications/7b7b-mimeapps.list";
+        dirs << tmp[i]+"/applications/mimeapps.list";
+    }
+    dirs.removeDuplicates();
+    return dirs;
+}
@@ -0,0 +1,90 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a cached resolver for the default applications in the
+//  (7b7b-)mimeapps.list files from the XDG config/data dirs
+//  All the files are parsed once into per-file hashes (highest priority first)
+//  and resolved defaults are remembered until inotify reports a change to
+//  one of the files (or the XDG variables change). Results are dropped again
+//  when the *.desktop files in the app dirs (or next to the resolved apps) change,
+//  so lookups never have to touch the disk. Missing dirs are watched through
+//  their closest existing parent.
+//  Changes are written to $XDG_CONFIG_HOME/7b7b-mimeapps.list in batches,
+//  as a single atomic replacement of the file.
+//  The mimeinfo.cache files from the application dirs are indexed the same
+//  way (mimetype -> *.desktop paths which exist), with their own watches.
+//===========================================
+#ifndef _LUMINA_LIBRARY_MIME_APPS_H
+#define _LUMINA_LIBRARY_MIME_APPS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class LMimeApps {
+public:
+    static LMimeApps* instance();
+
+    //Full path to the default *.desktop file (or binary) for the mimetype (empty if none)
+    QString defaultApp(QString mime);
+    //Change a number of defaults at once (an empty app removes the default for that mimetype)
+    bool setDefaultApps(const QHash<QString, QString> &defaults);
+
+    //All the *.desktop files registered for the mimetype in the mimeinfo.cache files (priority order)
+    QStringList availableApps(QString mime);
+
+    //Changes every time the files get re-read
+    quint64 generation();
+
+    //File which setDefaultApps() writes to
+    static QString userFile();
+
+private:
+    LMimeApps();
+    ~LMimeApps();
+
+    struct list_file {
+        QString workdir; //dir the file is in (relative app paths)
+        QHash<QString, QStringList> exact; //mimetype -> apps
+        QList< QPair<QRegularExpression, QStringList> > wildcards; //in file order
+    };
+
+    QMutex mutex;
+    QByteArray envkey; //XDG variables as they were when the files were read
+    QStringList paths; //all the candidate files (highest priority first)
+    QList<list_file> files; //files which exist (same order)
+    QHash<QString, QString> resolved; //mimetype -> result
+    int inotifyFD;
+    bool unwatched; //true if any of the dirs could not be watched
+    QStringList watchedDirs; //dirs watched with inotifyFD (list dirs and dirs of resolved apps)
+    QHash<int, QStringList> missingWatches; //watch on the closest parent of missing dirs -> entries in it which lead to them
+    QSet<int> appWatches; //watches on the dirs of resolved apps
+    bool forceRead;
+    QElapsedTimer readTime;
+    quint64 gen;
+    //mimeinfo.cache index
+    QByteArray infoenv;
+    QHash<QString, QStringList> available; //mimetype -> *.desktop paths
+    int infoFD;
+    bool infoUnwatched, infoRead;
+    QStringList infoDirs; //app dirs watched with infoFD
+    QHash<int, QStringList> infoMissing; //same as missingWatches
+    quint64 infoGen, resolvedInfo; //index re-reads / the one the resolved defaults were made with
+    QElapsedTimer infoTime;
+
+    void checkForChanges(); //mutex must already be locked
+    void checkInfoChanges(); //mutex must already be locked
+    QString resolve(QString mime); //mutex must already be locked
+    static QStringList candidatePaths();
+};
+
+#endif
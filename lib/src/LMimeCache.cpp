@@ -0,0 +1,358 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LMimeCache.h"
+
+#include <QtEndian>
+
+#include <cstring>
+#include <fnmatch.h>
+
+#define CACHE_HEADER_SIZE 40
+#define CASE_SENSITIVE_FLAG 0x100 //in the weight field of literal/glob/suffix entries
+
+LMimeCache::LMimeCache() {
+    data = 0;
+    size = 0;
+    aliasList = parentList = literalList = suffixTree = globList = magicList = iconsList = genericIconsList = 0;
+}
+
+LMimeCache::~LMimeCache() {
+    close();
+}
+
+bool LMimeCache::open(QString path) {
+    close();
+    file.setFileName(path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    qint64 fsize = file.size();
+    if(fsize < CACHE_HEADER_SIZE || fsize > 0xFFFFFFFF) {
+        file.close();
+        return false;
+    }
+    data = file.map(0, fsize);
+    if(data==0) {
+        file.close();
+        return false;
+    }
+    size = fsize;
+    //Header: major/minor version (16 bits each) and then the table offsets
+    quint16 major = qFromBigEndian<quint16>(data);
+    quint16 minor = qFromBigEndian<quint16>(data+2);
+    if(major!=1 || minor<1) {
+        //Version 1.0 does not have weights in the tables
+        close();
+        return false;
+    }
+    aliasList = card32(4);
+    parentList = card32(8);
+    literalList = card32(12);
+    suffixTree = card32(16);
+    globList = card32(20);
+    magicList = card32(24);
+    iconsList = card32(32);
+    genericIconsList = card32(36);
+    return true;
+}
+
+void LMimeCache::close() {
+    if(data!=0) {
+        file.unmap(const_cast<uchar*>(data));
+        data = 0;
+    }
+    size = 0;
+    aliasList = parentList = literalList = suffixTree = globList = magicList = iconsList = genericIconsList = 0;
+    if(file.isOpen()) {
+        file.close();
+    }
+}
+
+void LMimeCache::matchName(const QString &name, const char *utf8, const char *folded, MatchList &out) const {
+    if(data==0 || name.isEmpty()) {
+        return;
+    }
+    //Literal names: stored as-is if case-sensitive, lower-case otherwise
+    for(int f=0; f<2; f++) {
+        const char *key = (f==0) ? utf8 : folded;
+        int index = findEntry(literalList, 12, key);
+        if(index<0) {
+            continue;
+        }
+        //Walk back to the first entry for this literal (there can be several)
+        while(index>0 && strcmp(string(card32(literalList+4+12*(index-1))), key)==0) {
+            index--;
+        }
+        quint32 count = card32(literalList);
+        for(quint32 i=index; i<count; i++) {
+            quint32 entry = literalList+4+12*i;
+            if(strcmp(string(card32(entry)), key)!=0) {
+                break;
+            }
+            quint32 wf = card32(entry+8);
+            if(f==1 && (wf & CASE_SENSITIVE_FLAG)) {
+                continue;
+            }
+            Match M = {(int) (wf & 0xFF), MATCH_LITERAL, name.length(), card32(entry+4)};
+            out << M;
+        }
+    }
+    //Suffixes (exact case first, then folded)
+    walkSuffix(name, false, out);
+    walkSuffix(name, true, out);
+    //Everything else (usually only a few dozen)
+    quint32 count = card32(globList);
+    for(quint32 i=0; i<count; i++) {
+        quint32 entry = globList+4+12*i;
+        const char *glob = string(card32(entry));
+        quint32 wf = card32(entry+8);
+        int flags = (wf & CASE_SENSITIVE_FLAG) ? 0 : FNM_CASEFOLD;
+        if(fnmatch(glob, utf8, flags)==0) {
+            Match M = {(int) (wf & 0xFF), MATCH_GLOB, (int) strlen(glob), card32(entry+4)};
+            out << M;
+        }
+    }
+}
+
+QString LMimeCache::unalias(QString mime) const {
+    QByteArray key = mime.toLatin1();
+    int index = findEntry(aliasList, 8, key.constData());
+    if(index<0) {
+        return mime;
+    }
+    return mimeName(card32(aliasList+4+8*index+4));
+}
+
+QStringList LMimeCache::parents(QString mime) const {
+    QStringList out;
+    QByteArray key = mime.toLatin1();
+    int index = findEntry(parentList, 8, key.constData());
+    if(index<0) {
+        return out;
+    }
+    quint32 list = card32(parentList+4+8*index+4);
+    quint32 count = card32(list);
+    for(quint32 i=0; i<count; i++) {
+        out << mimeName(card32(list+4+4*i));
+    }
+    return out;
+}
+
+QString LMimeCache::icon(QString mime) const {
+    QByteArray key = mime.toLatin1();
+    int index = findEntry(iconsList, 8, key.constData());
+    if(index<0) {
+        return "";
+    }
+    return mimeName(card32(iconsList+4+8*index+4));
+}
+
+QString LMimeCache::genericIcon(QString mime) const {
+    QByteArray key = mime.toLatin1();
+    int index = findEntry(genericIconsList, 8, key.constData());
+    if(index<0) {
+        return "";
+    }
+    return mimeName(card32(genericIconsList+4+8*index+4));
+}
+
+bool LMimeCache::matchMagic(const char *buf, int len, int &priority, quint32 &mime) const {
+    if(magicList==0) {
+        return false;
+    }
+    //Magic list: <number of matches> <max extent> <first match>
+    // Matches are 16 bytes: <priority> <mime type> <number of matchlets> <first matchlet>
+    // and are already sorted by priority (highest first) so the first hit wins
+    quint32 count = card32(magicList);
+    quint32 first = card32(magicList+8);
+    for(quint32 i=0; i<count; i++) {
+        quint32 match = first+16*i;
+        if(matchlets(card32(match+8), card32(match+12), buf, len, 0)) {
+            priority = card32(match);
+            mime = card32(match+4);
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList LMimeCache::globLines() const {
+    QStringList out;
+    if(data==0) {
+        return out;
+    }
+    quint32 count = card32(literalList);
+    for(quint32 i=0; i<count; i++) {
+        quint32 entry = literalList+4+12*i;
+        quint32 wf = card32(entry+8);
+        out << QString::number(wf & 0xFF)+":"+mimeName(card32(entry+4))+":"+QString::fromUtf8(string(card32(entry)))+((wf & CASE_SENSITIVE_FLAG) ? ":cs" : "");
+    }
+    suffixLines(card32(suffixTree), card32(suffixTree+4), "", out);
+    count = card32(globList);
+    for(quint32 i=0; i<count; i++) {
+        quint32 entry = globList+4+12*i;
+        quint32 wf = card32(entry+8);
+        out << QString::number(wf & 0xFF)+":"+mimeName(card32(entry+4))+":"+QString::fromUtf8(string(card32(entry)))+((wf & CASE_SENSITIVE_FLAG) ? ":cs" : "");
+    }
+    return out;
+}
+
+// === PRIVATE ===
+quint32 LMimeCache::card32(quint32 offset) const {
+    if(data==0 || offset > size-4) {
+        return 0;    //out of range (corrupt file) - reads as an empty table
+    }
+    return qFromBigEndian<quint32>(data+offset);
+}
+
+const char* LMimeCache::string(quint32 offset) const {
+    if(data==0 || offset>=size || memchr(data+offset, 0, size-offset)==0) {
+        return "";
+    }
+    return (const char*) (data+offset);
+}
+
+int LMimeCache::findEntry(quint32 list, quint32 entrysize, const char *key) const {
+    if(list==0) {
+        return -1;
+    }
+    int min = 0;
+    int max = ((int) card32(list)) - 1;
+    while(min<=max) {
+        int mid = (min+max)/2;
+        int cmp = strcmp(string(card32(list+4+entrysize*mid)), key);
+        if(cmp==0) {
+            return mid;
+        }
+        else if(cmp<0) {
+            min = mid+1;
+        }
+        else {
+            max = mid-1;
+        }
+    }
+    return -1;
+}
+
+void LMimeCache::walkSuffix(const QString &name, bool fold, MatchList &out) const {
+    //Tree nodes are 12 bytes: <character> <number of children> <first child>
+    // Leaves sort first among the children and have character 0: <0> <mime type> <weight/flags>
+    quint32 count = card32(suffixTree);
+    quint32 first = card32(suffixTree+4);
+    int pos = name.length();
+    int consumed = 0;
+    while(pos>0 && count>0) {
+        char32_t ch = name[pos-1].unicode();
+        int width = 1;
+        if(name[pos-1].isLowSurrogate() && pos>1 && name[pos-2].isHighSurrogate()) {
+            ch = QChar::surrogateToUcs4(name[pos-2], name[pos-1]);
+            width = 2;
+        }
+        if(fold) {
+            ch = QChar::toLower(ch);
+        }
+        //Binary search the children for this character
+        quint32 node = 0;
+        int min = 0;
+        int max = ((int) count) - 1;
+        while(min<=max) {
+            int mid = (min+max)/2;
+            quint32 nch = card32(first+12*mid);
+            if(nch==ch) {
+                node = first+12*mid;
+                break;
+            }
+            else if(nch<ch) {
+                min = mid+1;
+            }
+            else {
+                max = mid-1;
+            }
+        }
+        if(node==0) {
+            return;
+        }
+        pos -= width;
+        consumed++;
+        count = card32(node+4);
+        first = card32(node+8);
+        //Stop before the first character - "*.ext" should not match a file named ".ext"
+        // (same as LMimeGlobs)
+        if(pos==0) {
+            break;
+        }
+        for(quint32 i=0; i<count; i++) {
+            quint32 leaf = first+12*i;
+            if(card32(leaf)!=0) {
+                break;    //no more leaves
+            }
+            quint32 wf = card32(leaf+8);
+            if(fold && (wf & CASE_SENSITIVE_FLAG)) {
+                continue;
+            }
+            Match M = {(int) (wf & 0xFF), MATCH_SUFFIX, consumed+1, card32(leaf+4)};
+            out << M;
+        }
+    }
+}
+
+bool LMimeCache::matchlets(quint32 count, quint32 first, const char *buf, int len, int depth) const {
+    //Matchlets are 32 bytes: <range start> <range length> <word size> <value length>
+    //  <value> <mask (0 if none)> <number of children> <first child>
+    // A matchlet with children only counts if one of the children matches as well
+    if(depth > 32) {
+        return false;    //corrupt file (loop)
+    }
+    for(quint32 i=0; i<count; i++) {
+        quint32 matchlet = first+32*i;
+        quint64 start = card32(matchlet);
+        quint64 range = qMax(card32(matchlet+4), (quint32) 1);
+        quint32 vlen = card32(matchlet+12);
+        quint32 value = card32(matchlet+16);
+        quint32 mask = card32(matchlet+20);
+        if(vlen==0 || ((quint64) value+vlen) > size || (mask!=0 && ((quint64) mask+vlen) > size)) {
+            continue;
+        }
+        //NOTE: The word size is not needed here - the cache already has the values in file byte order
+        for(quint64 off = start; off < start+range && (off+vlen) <= (quint64) len; off++) {
+            bool ok = true;
+            for(quint32 b=0; b<vlen && ok; b++) {
+                uchar byte = buf[off+b];
+                if(mask==0) {
+                    ok = (byte == data[value+b]);
+                }
+                else {
+                    ok = ((byte & data[mask+b]) == (data[value+b] & data[mask+b]));
+                }
+            }
+            if(!ok) {
+                continue;
+            }
+            if(card32(matchlet+24)==0 || matchlets(card32(matchlet+24), card32(matchlet+28), buf, len, depth+1)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void LMimeCache::suffixLines(quint32 count, quint32 first, QString suffix, QStringList &out) const {
+    if(suffix.length() > 255) {
+        return;    //corrupt tree (loop) - real suffixes are nowhere near this long
+    }
+    for(quint32 i=0; i<count; i++) {
+        quint32 node = first+12*i;
+        quint32 ch = card32(node);
+        if(ch==0) {
+            quint32 wf = card32(node+8);
+            out << QString::number(wf & 0xFF)+":"+mimeName(card32(node+4))+":*"+suffix+((wf & CASE_SENSITIVE_FLAG) ? ":cs" : "");
+        }
+        else {
+            char32_t uc = ch;
+            suffixLines(card32(node+4), card32(node+8), QString::fromUcs4(&uc, 1)+suffix, out);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a reader for the binary "mime.cache" file from shared-mime-info
+//  (written by update-mime-database next to the text globs2 file)
+//  The file is memory-mapped and all the lookups walk the tables in place,
+//  so nothing gets parsed or copied when it is opened.
+//  All numbers in the file are big-endian and every offset is from the start
+//  of the file - see the "Shared MIME-info Database" spec for the layout.
+//===========================================
+#ifndef _LUMINA_LIBRARY_MIME_CACHE_H
+#define _LUMINA_LIBRARY_MIME_CACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVarLengthArray>
+
+class LMimeCache {
+public:
+    enum MatchKind {MATCH_LITERAL, MATCH_SUFFIX, MATCH_GLOB}; //most specific first
+    struct Match {
+        int weight;
+        MatchKind kind;
+        int length; //length of the pattern which matched
+        quint32 mime; //offset of the mimetype string
+    };
+    typedef QVarLengthArray<Match, 16> MatchList; //stack storage for the usual handful of matches
+
+    LMimeCache();
+    ~LMimeCache();
+
+    //Map the cache file (returns false if missing or not a supported version)
+    bool open(QString path);
+    void close();
+    bool isOpen() const {
+        return (data!=0);
+    }
+
+    //Add all the filename patterns which match to the list (nothing gets allocated)
+    // "utf8"/"folded" are the same name already converted (lower-case for "folded" - shared between the caches)
+    void matchName(const QString &name, const char *utf8, const char *folded, MatchList &out) const;
+    QString mimeName(quint32 offset) const {
+        return QString::fromLatin1(string(offset));
+    }
+    QLatin1String mimeNameView(quint32 offset) const {
+        return QLatin1String(string(offset));
+    }
+
+    //Alias/inheritance tables
+    QString unalias(QString mime) const; //returns the input if it is not an alias
+    QStringList parents(QString mime) const;
+    //Icon names from the <icon>/<generic-icon> elements (empty if the type does not set one)
+    QString icon(QString mime) const;
+    QString genericIcon(QString mime) const;
+
+    //Content sniffing with the magic rules (buffer should be the first magicExtent() bytes of the file)
+    // Returns true for the highest-priority match and fills in the priority and the mimetype offset
+    quint32 magicExtent() const {
+        return (magicList==0) ? 0 : card32(magicList+4);
+    }
+    bool matchMagic(const char *buf, int len, int &priority, quint32 &mime) const;
+
+    //Rebuild the patterns in the globs2 line format: <weight>:<mime type>:<pattern>[:cs]
+    QStringList globLines() const;
+
+private:
+    QFile file;
+    const uchar *data;
+    quint32 size;
+    quint32 aliasList, parentList, literalList, suffixTree, globList, magicList, iconsList, genericIconsList;
+
+    quint32 card32(quint32 offset) const;
+    const char* string(quint32 offset) const; //never returns 0 (empty string instead)
+    //Binary search in a table of fixed-size entries sorted by the string at the start of each entry
+    int findEntry(quint32 list, quint32 entrysize, const char *key) const;
+    void walkSuffix(const QString &name, bool fold, MatchList &out) const;
+    bool matchlets(quint32 count, quint32 first, const char *buf, int len, int depth) const;
+    void suffixLines(quint32 count, quint32 first, QString suffix, QStringList &out) const;
+};
+
+#endif
@@ -0,0 +1,176 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LMimeComments.h"
+#include "LuminaXDG.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+
+#define CACHE_MAGIC 0x37626d63 //"7bmc"
+#define CACHE_VERSION 1
+#define XML_NAMESPACE "http://www.w3.org/XML/1998/namespace"
+
+LMimeComments* LMimeComments::instance() {
+    static LMimeComments *COMMENTS = 0;
+    static QMutex initmutex;
+    QMutexLocker lock(&initmutex);
+    if(COMMENTS==0) {
+        COMMENTS = new LMimeComments();
+    }
+    return COMMENTS;
+}
+
+LMimeComments::LMimeComments() {
+    checktime = 0;
+}
+
+QString LMimeComments::comment(QString mime) {
+    QMutexLocker lock(&mutex);
+    checkForChanges();
+    return table.value(mime);
+}
+
+// === PRIVATE ===
+void LMimeComments::checkForChanges() {
+    QString curlang = QString(getenv("LANG")).section(".",0,0);
+    if(checktime!=0 && curlang==lang && checktime > (QDateTime::currentMSecsSinceEpoch()-30000) ) {
+        return;
+    }
+    checktime = QDateTime::currentMSecsSinceEpoch();
+    //See which package files are around now (highest priority dir first)
+    QStringList dirs = LXDG::systemMimeDirs();
+    QStringList files;
+    for(int i=0; i<dirs.length(); i++) {
+        QDir dir(dirs[i]+"/packages");
+        QFileInfoList list = dir.entryInfoList(QStringList() << "*.xml", QDir::Files, QDir::Name);
+        for(int j=0; j<list.length(); j++) {
+            files << list[j].absoluteFilePath()+":"+QString::number(list[j].lastModified().toMSecsSinceEpoch());
+        }
+    }
+    if(files==sources && curlang==lang) {
+        return;    //nothing changed
+    }
+    lang = curlang;
+    sources = files;
+    table.clear();
+    QString cachefile = QString(getenv("XDG_CACHE_HOME")).section(":",0,0);
+    if(cachefile.isEmpty()) {
+        cachefile = QDir::homePath()+"/.cache";
+    }
+    cachefile.append("/7b7b");
+    if(!QFile::exists(cachefile)) {
+        QDir D;
+        D.mkpath(cachefile);
+    }
+    cachefile.append("/mimecomments.cache");
+    if(loadCache(cachefile)) {
+        return;
+    }
+    //Parse all the package files (first one to define a type wins, then the best language match within those files)
+    QSet<QString> seen;
+    for(int i=0; i<files.length(); i++) {
+        parseFile(files[i].section(":",0,-2), seen);
+    }
+    saveCache(cachefile);
+}
+
+bool LMimeComments::loadCache(QString file) {
+    QFile cache(file);
+    if(!cache.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&cache);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version;
+    QString clang;
+    QStringList csources;
+    in >> magic >> version;
+    if(in.status()!=QDataStream::Ok || magic!=CACHE_MAGIC || version!=CACHE_VERSION) {
+        return false;
+    }
+    in >> clang >> csources;
+    if(clang!=lang || csources!=sources) {
+        return false;    //stale
+    }
+    in >> table;
+    if(in.status()!=QDataStream::Ok) {
+        table.clear();
+        return false;
+    }
+    return true;
+}
+
+void LMimeComments::saveCache(QString file) {
+    QSaveFile cache(file);
+    if(!cache.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream out(&cache);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << (quint32) CACHE_MAGIC << (quint32) CACHE_VERSION << lang << sources << table;
+    if(out.status()!=QDataStream::Ok) {
+        cache.cancelWriting();
+        return;
+    }
+    cache.commit();
+}
+
+void LMimeComments::parseFile(QString path, QSet<QString> &seen) {
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QString shortlang = lang.section("_",0,0);
+    QXmlStreamReader xml(&file);
+    QString mime, best;
+    int bestrank = 0;
+    bool owned = false; //this file is the one which gets to define the current type
+    while(!xml.atEnd()) {
+        xml.readNext();
+        if(xml.isStartElement()) {
+            if(xml.name()==QLatin1String("mime-type")) {
+                mime = xml.attributes().value("type").toString();
+                owned = !seen.contains(mime);
+                best.clear();
+                bestrank = 0;
+            }
+            else if(owned && !mime.isEmpty() && xml.name()==QLatin1String("comment")) {
+                //Full language match, then short language, then general comment
+                QString clang = xml.attributes().value(XML_NAMESPACE, "lang").toString();
+                int crank = 0;
+                if(clang.isEmpty()) {
+                    crank = 1;
+                }
+                else if(clang==lang) {
+                    crank = 3;
+                }
+                else if(clang==shortlang) {
+                    crank = 2;
+                }
+                QString text = xml.readElementText();
+                if(crank > bestrank) {
+                    best = text;
+                    bestrank = crank;
+                }
+            }
+        }
+        else if(xml.isEndElement() && xml.name()==QLatin1String("mime-type")) {
+            if(owned && !mime.isEmpty()) {
+                seen.insert(mime);
+                if(!best.isEmpty()) {
+                    table.insert(mime, best);
+                }
+            }
+            mime.clear();
+            owned = false;
+        }
+    }
+}
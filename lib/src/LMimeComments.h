@@ -0,0 +1,43 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a table of the localized mimetype descriptions ("comments")
+//  All the packages/*.xml files from the mime dirs are read in a single
+//  streaming pass (instead of opening one <type>.xml file per lookup) and the
+//  result is kept in $XDG_CACHE_HOME/7b7b/mimecomments.cache until one of the
+//  package files or the language changes.
+//===========================================
+#ifndef _LUMINA_LIBRARY_MIME_COMMENTS_H
+#define _LUMINA_LIBRARY_MIME_COMMENTS_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class LMimeComments {
+public:
+    static LMimeComments* instance();
+
+    //Description of the mimetype in the current language (empty if unknown)
+    QString comment(QString mime);
+
+private:
+    LMimeComments();
+
+    QMutex mutex;
+    QString lang; //language the table was built for
+    QStringList sources; //"<path>:<mtime>" for each package file used
+    QHash<QString, QString> table; //mimetype -> comment
+    qint64 checktime;
+
+    void checkForChanges(); //mutex must already be locked
+    bool loadCache(QString file);
+    void saveCache(QString file);
+    void parseFile(QString path, QSet<QString> &seen);
+};
+
+#endif
@@ -0,0 +1,147 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LMimeDatabase.h"
+#include "LuminaXDG.h"
+#include "LuminaOS.h"
+
+#include <QFileInfo>
+
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define CHECK_INTERVAL 500 //ms between looking at the watches (lookups in between just use the current version)
+
+//Drain the inotify queue - returns true if any of the events are for a database file
+static bool pendingEvents(int fd) {
+    bool found = false;
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while( (len = ::read(fd, buf, sizeof(buf))) > 0 ) {
+        for(char *ptr = buf; ptr < buf+len; ptr += sizeof(struct inotify_event) + ((struct inotify_event*) ptr)->len) {
+            struct inotify_event *ev = (struct inotify_event*) ptr;
+            if(ev->len==0) {
+                found = true;    //event for a watched dir itself
+                continue;
+            }
+            //update-mime-database writes lots of other files in there too - only the ones which get loaded matter
+            if(strcmp(ev->name, "mime.cache")==0 || strcmp(ev->name, "globs2")==0 || strcmp(ev->name, "mime")==0) {
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+LMimeDatabase* LMimeDatabase::instance() {
+    static LMimeDatabase *DATABASE = 0;
+    static QMutex initmutex;
+    QMutexLocker lock(&initmutex);
+    if(DATABASE==0) {
+        DATABASE = new LMimeDatabase();
+    }
+    return DATABASE;
+}
+
+LMimeDatabase::LMimeDatabase() {
+    inotifyFD = -1;
+    unwatched = false;
+    clock.start();
+    nextCheck.storeRelaxed(0);
+}
+
+LMimeDatabase::~LMimeDatabase() {
+    if(inotifyFD>=0) {
+        ::close(inotifyFD);
+    }
+}
+
+std::shared_ptr<const LMimeGlobs> LMimeDatabase::globs() {
+    lookupCount.fetchAndAddRelaxed(1);
+    std::shared_ptr<const LMimeGlobs> snap = std::atomic_load(&current);
+    if(snap) {
+        if(clock.elapsed() < nextCheck.loadRelaxed()) {
+            return snap;    //checked for changes very recently - no need for the env/inotify round trip
+        }
+        if(!mutex.tryLock()) {
+            return snap;    //another thread is already checking - this version is still good until it gets swapped
+        }
+    } else {
+        mutex.lock();
+    }
+    checkForChanges();
+    snap = current;
+    mutex.unlock();
+    return snap;
+}
+
+// === PRIVATE ===
+void LMimeDatabase::checkForChanges() {
+    QByteArray env = qgetenv("XDG_DATA_HOME")+":"+qgetenv("XDG_DATA_DIRS");
+    bool dirty = !current || (dataenv != env);
+    if(!dirty && unwatched && checkTime.elapsed() > 5000) {
+        dirty = true;    //some dirs could not be watched - look at them every so often instead
+    }
+    if(inotifyFD>=0 && pendingEvents(inotifyFD)) {
+        dirty = true;
+    }
+    nextCheck.storeRelaxed(clock.elapsed()+CHECK_INTERVAL);
+    if(!dirty) {
+        return;
+    }
+    //Set up the watches again (closing the old descriptor drops all the old watches)
+    if(inotifyFD>=0) {
+        ::close(inotifyFD);
+    }
+    inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    unwatched = (inotifyFD<0);
+    dataenv = env;
+    if(inotifyFD>=0) {
+        //Watch the data dirs too, so a new "mime" dir (first update-mime-database run) gets noticed
+        QStringList datadirs = QString(env).split(":", Qt::SkipEmptyParts);
+        for(int i=0; i<datadirs.length(); i++) {
+            inotify_add_watch(inotifyFD, datadirs[i].toLocal8Bit().constData(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+        }
+    }
+    QStringList dirs = LXDG::systemMimeDirs();
+    QStringList files;
+    for(int i=0; i<dirs.length(); i++) {
+        //Watch before looking at the files so nothing gets lost in between
+        if(inotifyFD>=0 && inotify_add_watch(inotifyFD, dirs[i].toLocal8Bit().constData(), IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0) {
+            unwatched = true;
+        }
+        //Binary mime.cache preferred over the text globs2
+        QFileInfo info(dirs[i]+"/mime.cache");
+        if(!info.exists()) {
+            info.setFile(dirs[i]+"/globs2");
+        }
+        if(info.exists()) {
+            files << info.absoluteFilePath()+":"+QString::number(info.lastModified().toMSecsSinceEpoch());
+        }
+    }
+    if(files.isEmpty()) {
+        //Could not find the mimetype database on the system - use the fallback file distributed with 7b7b
+        QFileInfo info(LOS::LuminaShare()+"/globs2");
+        files << info.absoluteFilePath()+":"+QString::number(info.lastModified().toMSecsSinceEpoch());
+    }
+    checkTime.start();
+    if(current && files == sources) {
+        return;    //nothing changed - keep the compiled version
+    }
+    //qDebug() << "Loading mime DB files:" << files;
+    std::shared_ptr<LMimeGlobs> globs = std::make_shared<LMimeGlobs>();
+    for(int i=0; i<files.length(); i++) {
+        QString path = files[i].section(":",0,-2);
+        if(path.endsWith("/mime.cache") && globs->loadCache(path)) {
+            continue;
+        }
+        //Unsupported/broken cache - use the text file from the same dir
+        globs->loadGlobs2(path.section("/",0,-2)+"/globs2");
+    }
+    sources = files;
+    std::atomic_store(&current, std::shared_ptr<const LMimeGlobs>(globs));
+    rebuildCount.fetchAndAddRelaxed(1);
+}
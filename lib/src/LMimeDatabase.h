@@ -0,0 +1,62 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is the shared copy of the mimetype database (LMimeGlobs)
+//  A loaded database never changes: a reload builds a new one and swaps the
+//  pointer, so callers (including worker threads) can keep using the copy they
+//  got for as long as they hold on to it.
+//  The database is only rebuilt when inotify reports a change to one of the
+//  mime.cache/globs2 files in the mime dirs (or the XDG data dirs change).
+//  Those are only looked at every so often, so a lookup in between is just an
+//  atomic load of the current version.
+//===========================================
+#ifndef _LUMINA_LIBRARY_MIME_DATABASE_H
+#define _LUMINA_LIBRARY_MIME_DATABASE_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+#include "LMimeGlobs.h"
+
+class LMimeDatabase {
+public:
+    static LMimeDatabase* instance();
+
+    //Current version of the database (never null - might be empty if nothing could be read)
+    std::shared_ptr<const LMimeGlobs> globs();
+
+    //Counters for checking how often the database gets used/reloaded
+    quint64 lookups() const {
+        return lookupCount.loadRelaxed();
+    }
+    quint64 rebuilds() const {
+        return rebuildCount.loadRelaxed();
+    }
+
+private:
+    LMimeDatabase();
+    ~LMimeDatabase();
+
+    QMutex mutex; //held while checking for changes/rebuilding
+    std::shared_ptr<const LMimeGlobs> current; //only use with std::atomic_load/store
+    QByteArray dataenv; //XDG data dirs when the watches were set up
+    QStringList sources; //"<path>:<mtime>" for each file used in the current database
+    int inotifyFD;
+    bool unwatched; //true if any of the dirs could not be watched
+    QElapsedTimer checkTime;
+    QElapsedTimer clock; //started once - only read after that
+    QAtomicInteger<qint64> nextCheck; //clock time for the next look at the watches
+    QAtomicInteger<quint64> lookupCount, rebuildCount;
+
+    void checkForChanges(); //mutex must already be locked
+};
+
+#endif
@@ -0,0 +1,421 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LMimeGlobs.h"
+
+#include <QFile>
+#include <QStringEncoder>
+#include <QTextStream>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNIFF_MAX_BYTES 4096 //never read more than this from a file
+#define SNIFF_CACHE_SIZE 4096 //number of sniffed files to remember
+
+LMimeGlobs::LMimeGlobs() {
+    clear();
+}
+
+LMimeGlobs::~LMimeGlobs() {
+    qDeleteAll(caches);
+}
+
+bool LMimeGlobs::loadGlobs2(QString path) {
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream in(&file);
+    while(!in.atEnd()) {
+        QString line = in.readLine().simplified();
+        if(line.isEmpty() || line.startsWith("#")) {
+            continue;
+        }
+        //Format: <weight>:<mime type>:<pattern>[:flags]
+        QStringList fields = line.split(":");
+        if(fields.length()<3 || fields[1].isEmpty() || fields[2].isEmpty()) {
+            continue;
+        }
+        rawlines << line;
+        bool cs = (fields.length()>3 && fields[3].split(",").contains("cs"));
+        addGlob(fields[0].toInt(), fields[1], fields[2], cs);
+    }
+    file.close();
+    return true;
+}
+
+bool LMimeGlobs::loadCache(QString path) {
+    LMimeCache *cache = new LMimeCache();
+    if(!cache->open(path)) {
+        delete cache;
+        return false;
+    }
+    caches << cache;
+    cachelines = false;
+    sniffExtent = qMax(sniffExtent, (int) qMin(cache->magicExtent(), (quint32) SNIFF_MAX_BYTES));
+    //The list of known types lives in a text file next to the cache
+    QFile file(path.section("/",0,-2)+"/types");
+    if(file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream in(&file);
+        while(!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if(!line.isEmpty()) {
+                mimetypes << line;
+            }
+        }
+        file.close();
+    }
+    return true;
+}
+
+void LMimeGlobs::addGlob(int weight, QString mime, QString pattern, bool caseSensitive) {
+    static const QString wildchars = "*?[";
+    glob G;
+    G.weight = weight;
+    G.mime = mime;
+    G.pattern = pattern;
+    //Figure out which bucket this pattern belongs in
+    bool literal = true;
+    bool suffix = pattern.startsWith("*");
+    for(int i=0; i<pattern.length() && (literal || suffix); i++) {
+        if(wildchars.contains(pattern[i])) {
+            literal = false;
+            if(i>0) {
+                suffix = false;
+            }
+        }
+    }
+    if(pattern.length()<2) {
+        suffix = false;    //a bare "*" is not a suffix
+    }
+    int index = globs.length();
+    if(literal) {
+        G.kind = LMimeCache::MATCH_LITERAL;
+        if(caseSensitive) {
+            literalCS[pattern] << index;
+        } else {
+            literalFolded[pattern.toLower()] << index;
+        }
+    } else if(suffix) {
+        G.kind = LMimeCache::MATCH_SUFFIX;
+        if(caseSensitive) {
+            trieInsert(suffixCS, pattern.mid(1), index);
+        } else {
+            trieInsert(suffixFolded, pattern.mid(1).toLower(), index);
+        }
+    } else {
+        G.kind = LMimeCache::MATCH_GLOB;
+        QRegularExpression rx = QRegularExpression::fromWildcard(pattern, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+        if(!rx.isValid()) {
+            return;
+        }
+        rx.optimize();
+        fallback << qMakePair(index, rx);
+    }
+    globs << G;
+    mimetypes << mime;
+}
+
+void LMimeGlobs::clear() {
+    globs.clear();
+    qDeleteAll(caches);
+    caches.clear();
+    rawlines.clear();
+    cachelines = true; //no caches yet
+    sniffExtent = 0;
+    sniffed.clear();
+    mimetypes.clear();
+    literalCS.clear();
+    literalFolded.clear();
+    fallback.clear();
+    suffixCS.assign(1, trie_node());
+    suffixFolded.assign(1, trie_node());
+}
+
+//UTF-8 copy of a string (nul-terminated) - stays on the stack for any normal file name
+static void encodeUtf8(QStringView str, QVarLengthArray<char, 256> &out) {
+    QStringEncoder encoder(QStringConverter::Utf8);
+    out.resize(encoder.requiredSpace(str.length())+1);
+    char *end = encoder.appendToBuffer(out.data(), str);
+    *end = 0;
+    out.resize(end-out.data()+1);
+}
+
+QStringList LMimeGlobs::match(QString filename, bool *tied) const {
+    //Only the result list gets allocated on the binary cache path:
+    // the hits just point into the caches/compiled globs until the output gets built
+    struct hit {
+        int weight;
+        LMimeCache::MatchKind kind;
+        int length;
+        int source; //index of the cache (-1: compiled text glob)
+        quint32 mime; //mimetype offset in the cache (index of the glob for text globs)
+    };
+    QVarLengthArray<hit, 16> hits;
+    if(tied!=0) {
+        *tied = false;
+    }
+    if(filename.isEmpty()) {
+        return QStringList();
+    }
+    //Binary caches
+    if(!caches.isEmpty()) {
+        //Lower-case copy the same way the suffix tree gets walked (one code point at a time)
+        QVarLengthArray<char16_t, 256> lower;
+        for(int i=0; i<filename.length(); i++) {
+            if(filename[i].isHighSurrogate() && i+1<filename.length() && filename[i+1].isLowSurrogate()) {
+                char32_t ch = QChar::toLower(QChar::surrogateToUcs4(filename[i], filename[i+1]));
+                lower << QChar::highSurrogate(ch) << QChar::lowSurrogate(ch);
+                i++;
+            } else {
+                lower << (char16_t) QChar::toLower(filename[i].unicode());
+            }
+        }
+        QVarLengthArray<char, 256> utf8, folded;
+        encodeUtf8(filename, utf8);
+        encodeUtf8(QStringView(lower.constData(), lower.size()), folded);
+        LMimeCache::MatchList found;
+        for(int c=0; c<caches.length(); c++) {
+            found.clear();
+            caches[c]->matchName(filename, utf8.constData(), folded.constData(), found);
+            for(int i=0; i<found.size(); i++) {
+                hit H = {found[i].weight, found[i].kind, found[i].length, c, found[i].mime};
+                hits << H;
+            }
+        }
+    }
+    //Compiled text globs (only for dirs without a mime.cache)
+    if(!globs.isEmpty()) {
+        QVarLengthArray<int, 16> index;
+        QString folded = filename.toLower();
+        const QList<int> literals = literalCS.value(filename);
+        index.append(literals.constData(), literals.size());
+        const QList<int> foldedLiterals = literalFolded.value(folded);
+        index.append(foldedLiterals.constData(), foldedLiterals.size());
+        trieWalk(suffixCS, filename, index);
+        trieWalk(suffixFolded, folded, index);
+        for(int i=0; i<fallback.length(); i++) {
+            if(fallback[i].second.match(filename).hasMatch()) {
+                index << fallback[i].first;
+            }
+        }
+        for(int i=0; i<index.size(); i++) {
+            const glob &G = globs[index[i]];
+            hit H = {G.weight, G.kind, (int) G.pattern.length(), -1, (quint32) index[i]};
+            hits << H;
+        }
+    }
+    if(hits.isEmpty()) {
+        return QStringList();
+    }
+    //Highest weight first, then literal names, then the longest (most specific) pattern
+    // (stable insertion sort - only ever a handful of hits, and std::stable_sort wants a heap buffer)
+    for(int i=1; i<hits.size(); i++) {
+        hit H = hits[i];
+        int j = i;
+        while(j>0) {
+            const hit &prev = hits[j-1];
+            bool before = (H.weight != prev.weight) ? (H.weight > prev.weight) : ( (H.kind != prev.kind) ? (H.kind < prev.kind) : (H.length > prev.length) );
+            if(!before) {
+                break;
+            }
+            hits[j] = prev;
+            j--;
+        }
+        hits[j] = H;
+    }
+    QStringList out;
+    for(int i=0; i<hits.size(); i++) {
+        if(hits[i].source<0 ? out.contains(globs[hits[i].mime].mime) : out.contains(caches[hits[i].source]->mimeNameView(hits[i].mime))) {
+            continue;
+        }
+        if(out.length()==1 && tied!=0) {
+            *tied = (hits[i].weight==hits[0].weight && hits[i].length==hits[0].length);
+        }
+        out << (hits[i].source<0 ? globs[hits[i].mime].mime : caches[hits[i].source]->mimeName(hits[i].mime));
+    }
+    return out;
+}
+
+bool LMimeGlobs::isMimeType(QString mime) const {
+    if(mimetypes.contains(mime)) {
+        return true;
+    }
+    for(int i=0; i<caches.length(); i++) {
+        if(caches[i]->unalias(mime)!=mime) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString LMimeGlobs::iconName(QString mime) const {
+    for(int i=0; i<caches.length(); i++) {
+        QString icon = caches[i]->icon(mime);
+        if(!icon.isEmpty()) {
+            return icon;
+        }
+    }
+    return mime.replace("/","-");
+}
+
+QString LMimeGlobs::genericIconName(QString mime) const {
+    for(int i=0; i<caches.length(); i++) {
+        QString icon = caches[i]->genericIcon(mime);
+        if(!icon.isEmpty()) {
+            return icon;
+        }
+    }
+    return mime.section("/",0,0)+"-x-generic";
+}
+
+QString LMimeGlobs::sniffFile(QString path) const {
+    return sniffFiles(QStringList() << path).first();
+}
+
+QStringList LMimeGlobs::sniffFiles(QStringList paths) const {
+    QStringList out;
+    QList<sniff_key> keys;
+    QList<int> todo;
+    //Stat everything first and pick up the results we already have
+    for(int i=0; i<paths.length(); i++) {
+        struct stat st;
+        sniff_key key = {0, 0, 0};
+        out << QString();
+        if(stat(QFile::encodeName(paths[i]).constData(), &st)==0 && S_ISREG(st.st_mode)) {
+            key.dev = st.st_dev;
+            key.ino = st.st_ino;
+            key.mtime = ((qint64) st.st_mtim.tv_sec)*1000000000 + st.st_mtim.tv_nsec;
+            if(st.st_size==0) {
+                out[i] = "application/x-zerosize";
+            }
+            else {
+                todo << i;
+            }
+        }
+        keys << key;
+    }
+    if(todo.isEmpty()) {
+        return out;
+    }
+    sniffmutex.lock();
+    for(int t=0; t<todo.length(); t++) {
+        if(sniffed.contains(keys[todo[t]])) {
+            out[todo[t]] = sniffed.value(keys[todo[t]]);
+            todo.removeAt(t);
+            t--;
+        }
+    }
+    sniffmutex.unlock();
+    //Now read the start of each of the remaining files (one buffer for all of them)
+    QByteArray buffer(qMax(sniffExtent, 512), '\0');
+    for(int t=0; t<todo.length(); t++) {
+        int fd = ::open(QFile::encodeName(paths[todo[t]]).constData(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+        if(fd<0) {
+            continue;
+        }
+        ssize_t len = pread(fd, buffer.data(), buffer.size(), 0);
+        ::close(fd);
+        if(len>=0) {
+            out[todo[t]] = sniffData(buffer.constData(), len);
+        }
+    }
+    sniffmutex.lock();
+    if(sniffed.count() + todo.length() > SNIFF_CACHE_SIZE) {
+        sniffed.clear();
+    }
+    for(int t=0; t<todo.length(); t++) {
+        if(!out[todo[t]].isEmpty()) {
+            sniffed.insert(keys[todo[t]], out[todo[t]]);
+        }
+    }
+    sniffmutex.unlock();
+    return out;
+}
+
+QString LMimeGlobs::sniffData(const char *buf, int len) const {
+    if(len<=0) {
+        return "application/x-zerosize";
+    }
+    //Magic rules: highest priority across all the caches
+    int best = -1;
+    QString mime;
+    for(int i=0; i<caches.length(); i++) {
+        int priority;
+        quint32 offset;
+        if(caches[i]->matchMagic(buf, len, priority, offset) && priority>best) {
+            best = priority;
+            mime = caches[i]->mimeName(offset);
+        }
+    }
+    if(!mime.isEmpty()) {
+        return mime;
+    }
+    //No rules matched - just decide between text and binary data
+    for(int i=0; i<len; i++) {
+        uchar ch = buf[i];
+        if(ch<0x20 && ch!='\t' && ch!='\n' && ch!='\r' && ch!='\f' && ch!='\b' && ch!=0x1B) {
+            return "application/octet-stream";
+        }
+    }
+    return "text/plain";
+}
+
+QStringList LMimeGlobs::lines() const {
+    QMutexLocker lock(&linesmutex);
+    if(!cachelines) {
+        for(int i=0; i<caches.length(); i++) {
+            rawlines << caches[i]->globLines();
+        }
+        cachelines = true;
+    }
+    return rawlines;
+}
+
+void LMimeGlobs::trieInsert(std::vector<trie_node> &trie, const QString &suffix, int glob) {
+    int node = 0;
+    for(int i=suffix.length()-1; i>=0; i--) {
+        char16_t ch = suffix[i].unicode();
+        int next = -1;
+        for(size_t k=0; k<trie[node].kids.size(); k++) {
+            if(trie[node].kids[k].first == ch) {
+                next = trie[node].kids[k].second;
+                break;
+            }
+        }
+        if(next<0) {
+            next = trie.size();
+            trie[node].kids.push_back(std::make_pair(ch, next));
+            trie.push_back(trie_node()); //invalidates references - only use indexes above
+        }
+        node = next;
+    }
+    trie[node].hits << glob;
+}
+
+void LMimeGlobs::trieWalk(const std::vector<trie_node> &trie, const QString &name, QVarLengthArray<int, 16> &out) {
+    int node = 0;
+    //Stop before the first character - "*.ext" should not match a file named ".ext"
+    // unless there is something in front of it (same as the old filter-based lookup)
+    for(int i=name.length()-1; i>0; i--) {
+        char16_t ch = name[i].unicode();
+        int next = -1;
+        const std::vector< std::pair<char16_t, int> > &kids = trie[node].kids;
+        for(size_t k=0; k<kids.size(); k++) {
+            if(kids[k].first == ch) {
+                next = kids[k].second;
+                break;
+            }
+        }
+        if(next<0) {
+            return;
+        }
+        node = next;
+        out.append(trie[node].hits.constData(), trie[node].hits.size());
+    }
+}
@@ -0,0 +1,113 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a compiled matcher for the shared-mime-info "globs2" files
+//  Patterns get sorted into three buckets when loaded:
+//   - literal names ("Makefile") -> hash lookup
+//   - simple suffixes ("*.tar.gz") -> reversed-suffix trie (case-sensitive + folded)
+//   - anything else ("README*", "*.[1-9]") -> short fallback list of wildcards
+//  so classifying a filename is a single walk backwards over its characters
+//  instead of a scan over every line in the database.
+//  Directories with a binary mime.cache are used through LMimeCache instead
+//  (nothing to compile - the text globs2 is only a fallback).
+//  Content sniffing (magic rules) is only available from the binary caches
+//  and the results are kept per (device, inode, mtime).
+//===========================================
+#ifndef _LUMINA_LIBRARY_MIME_GLOBS_H
+#define _LUMINA_LIBRARY_MIME_GLOBS_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVarLengthArray>
+
+#include <vector>
+
+#include "LMimeCache.h"
+
+class LMimeGlobs {
+public:
+    LMimeGlobs();
+    ~LMimeGlobs();
+
+    //Add the contents of a globs2 file (returns false if it could not be read)
+    bool loadGlobs2(QString path);
+    //Use a binary mime.cache file (returns false if it could not be mapped)
+    bool loadCache(QString path);
+    //Add a single pattern (flags: "cs" for case-sensitive)
+    void addGlob(int weight, QString mime, QString pattern, bool caseSensitive = false);
+    void clear();
+    bool isEmpty() const {
+        return (globs.isEmpty() && caches.isEmpty());
+    }
+
+    //All the matching mimetypes for the filename (highest weight first, no duplicates)
+    // "tied" gets set if the first two types are equally good matches (needs sniffing to decide)
+    QStringList match(QString filename, bool *tied = 0) const;
+    //Is this a mimetype known to the database?
+    bool isMimeType(QString mime) const;
+    //Icon names for a mimetype ("image/png" -> "image-png", generic: "image-x-generic")
+    QString iconName(QString mime) const;
+    QString genericIconName(QString mime) const;
+
+    //Content sniffing for files where the name is not enough
+    // Only the first few KB of each file are read (single pread) - returns an empty string for unreadable files
+    QString sniffFile(QString path) const;
+    QStringList sniffFiles(QStringList paths) const; //same order as the input
+    //Sniff an in-memory buffer (start of the file)
+    QString sniffData(const char *buf, int len) const;
+
+    //Raw database lines in the globs2 format: <weight>:<mime type>:<pattern>[:flags]
+    // (rebuilt from the mime.cache files the first time this is needed)
+    QStringList lines() const;
+
+private:
+    Q_DISABLE_COPY(LMimeGlobs)
+    struct glob {
+        int weight;
+        LMimeCache::MatchKind kind;
+        QString mime, pattern;
+    };
+    struct trie_node {
+        std::vector< std::pair<char16_t, int> > kids; //character -> node index
+        QList<int> hits; //globs which end at this node
+    };
+
+    QList<glob> globs;
+    QList<LMimeCache*> caches;
+    mutable QStringList rawlines;
+    mutable bool cachelines; //rawlines includes the lines from the caches
+    mutable QMutex linesmutex;
+    QSet<QString> mimetypes;
+    //Literal filename patterns
+    QHash<QString, QList<int> > literalCS, literalFolded; //folded keys are lower-case
+    //Reversed suffix patterns (node 0 is the root)
+    std::vector<trie_node> suffixCS, suffixFolded;
+    //Everything else
+    QList< QPair<int, QRegularExpression> > fallback;
+    //Sniffed file types
+    struct sniff_key {
+        quint64 dev, ino;
+        qint64 mtime; //nsecs
+        bool operator==(const sniff_key &other) const {
+            return (dev==other.dev && ino==other.ino && mtime==other.mtime);
+        }
+        friend size_t qHash(const sniff_key &key, size_t seed = 0) {
+            return qHashMulti(seed, key.dev, key.ino, key.mtime);
+        }
+    };
+    int sniffExtent; //number of bytes the magic rules look at
+    mutable QHash<sniff_key, QString> sniffed;
+    mutable QMutex sniffmutex;
+
+    static void trieInsert(std::vector<trie_node> &trie, const QString &suffix, int glob);
+    static void trieWalk(const std::vector<trie_node> &trie, const QString &name, QVarLengthArray<int, 16> &out);
+};
+
+#endif
@@ -0,0 +1,143 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LPathResolver.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+LPathResolver* LPathResolver::instance() {
+    static LPathResolver *RESOLVER = 0;
+    static QMutex initmutex;
+    QMutexLocker lock(&initmutex);
+    if(RESOLVER==0) {
+        RESOLVER = new LPathResolver();
+    }
+    return RESOLVER;
+}
+
+LPathResolver::LPathResolver() {
+    inotifyFD = -1;
+    gen = 0;
+    unwatched = false;
+}
+
+LPathResolver::~LPathResolver() {
+    if(inotifyFD>=0) {
+        ::close(inotifyFD);
+    }
+}
+
+QString LPathResolver::resolve(QString bin) {
+    if(bin.isEmpty()) {
+        return "";
+    }
+    if(bin.contains("/")) {
+        //Relative path with a subdir - not something the listings can answer
+        QStringList paths = QString(getenv("PATH")).split(":");
+        for(int i=0; i<paths.length(); i++) {
+            if(QFile::exists(paths[i]+"/"+bin)) {
+                return (paths[i]+"/"+bin);
+            }
+        }
+        return "";
+    }
+    QMutexLocker lock(&mutex);
+    checkForChanges();
+    for(int i=0; i<dirs.length(); i++) {
+        if(contents[i].contains(bin)) {
+            return (dirs[i]+"/"+bin);
+        }
+    }
+    return "";
+}
+
+quint64 LPathResolver::generation() {
+    QMutexLocker lock(&mutex);
+    checkForChanges();
+    return gen;
+}
+
+void LPathResolver::checkForChanges() {
+    const char *env = getenv("PATH");
+    if(env==0) {
+        env = "";
+    }
+    bool dirty = (gen==0) || (pathenv != env);
+    if(!dirty && unwatched && readTime.elapsed() > 5000) {
+        dirty = true;    //some dirs could not be watched - re-read every so often instead
+    }
+    if(inotifyFD>=0) {
+        //Non-blocking: any pending event means one of the dirs changed
+        // (on the parents of missing dirs: only if it is the next dir on the way to one of those)
+        char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        ssize_t len;
+        while( (len = ::read(inotifyFD, buf, sizeof(buf))) > 0 ) {
+            const struct inotify_event *ev = 0;
+            for(char *ptr = buf; ptr < buf+len && !dirty; ptr += sizeof(struct inotify_event) + ev->len) {
+                ev = (const struct inotify_event*) ptr;
+                dirty = !missingWatches.contains(ev->wd) || (ev->mask & IN_Q_OVERFLOW)
+                        || (ev->len>0 && missingWatches.value(ev->wd).contains(QString::fromLocal8Bit(ev->name)));
+            }
+        }
+    }
+    if(!dirty) {
+        return;
+    }
+    //Re-read all the listings (closing the old descriptor drops all the old watches)
+    if(inotifyFD>=0) {
+        ::close(inotifyFD);
+    }
+    inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    pathenv = QByteArray(env);
+    QStringList olddirs = dirs;
+    QList< QSet<QString> > oldcontents = contents;
+    dirs.clear();
+    contents.clear();
+    unwatched = (inotifyFD<0);
+    missingWatches.clear();
+    QStringList paths = QString(pathenv).split(":", Qt::SkipEmptyParts);
+    for(int i=0; i<paths.length(); i++) {
+        if(dirs.contains(paths[i])) {
+            continue;    //duplicate PATH entry - the first one always wins anyway
+        }
+        //Watch before listing so nothing gets lost in between
+        if(inotifyFD>=0 && QFileInfo(paths[i]).isDir()) {
+            if(inotify_add_watch(inotifyFD, paths[i].toLocal8Bit().constData(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0) {
+                unwatched = true;    //out of watches
+            }
+        } else if(inotifyFD>=0 && paths[i].startsWith("/")) {
+            //Missing dir (common on PATH) - watch for it getting created instead
+            QString parent = paths[i].section("/",0,-2);
+            while(!parent.isEmpty() && !QFileInfo(parent).isDir()) {
+                parent = parent.section("/",0,-2);
+            }
+            QString next = paths[i].mid(parent.length()+1).section("/",0,0,QString::SectionSkipEmpty); //entry in the parent which would lead to it
+            if(parent.isEmpty()) {
+                parent = "/";
+            }
+            if(paths.contains(parent)) {
+                continue;    //already fully watched as a PATH dir (nothing to list here either)
+            }
+            int wd = inotify_add_watch(inotifyFD, parent.toLocal8Bit().constData(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR); //same descriptor for the same parent
+            if(wd<0) {
+                unwatched = true;
+            } else {
+                missingWatches[wd] << next;
+            }
+        }
+        QStringList list = QDir(paths[i]).entryList(QDir::AllEntries | QDir::System | QDir::Hidden | QDir::NoDotAndDotDot);
+        dirs << paths[i];
+        contents << QSet<QString>(list.begin(), list.end());
+    }
+    readTime.start();
+    if(gen==0 || dirs!=olddirs || contents!=oldcontents) {
+        gen++;    //only when something callers might have memoized actually changed
+    }
+}
@@ -0,0 +1,55 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a cached lookup of executables on the current PATH
+//  Each PATH directory is listed once into a hash set, and the sets are
+//  only re-read when PATH changes or inotify reports a change in one of
+//  the directories (or the creation of a missing one). The generation
+//  counter increases whenever a re-read finds different contents so
+//  callers can memoize their own results against it.
+//===========================================
+#ifndef _LUMINA_LIBRARY_PATH_RESOLVER_H
+#define _LUMINA_LIBRARY_PATH_RESOLVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class LPathResolver {
+public:
+    static LPathResolver* instance();
+
+    //Full path to the first match for the binary on PATH (empty if not found)
+    QString resolve(QString bin);
+    bool exists(QString bin) {
+        return !resolve(bin).isEmpty();
+    }
+
+    //Changes every time the cached listings change
+    quint64 generation();
+
+private:
+    LPathResolver();
+    ~LPathResolver();
+
+    QMutex mutex;
+    QByteArray pathenv; //PATH as it was when the listings were read
+    QStringList dirs;
+    QList< QSet<QString> > contents; //entries within each of the dirs (same order)
+    int inotifyFD;
+    bool unwatched; //true if any of the dirs (or parents of missing ones) could not be watched
+    QHash<int, QStringList> missingWatches; //watch on the closest parent of missing dirs -> entries in it which lead to them
+    QElapsedTimer readTime;
+    quint64 gen;
+
+    void checkForChanges(); //mutex must already be locked
+};
+
+#endif
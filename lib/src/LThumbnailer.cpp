@@ -0,0 +1,184 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+#include "LThumbnailer.h"
+#include "LDesktopUtils.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QThread>
+#include <QUrl>
+#include <QtConcurrent>
+
+//File URI and thumbnail file name for a file (as described in the spec)
+static QString fileURI(QString file) {
+    return QString::fromUtf8( QUrl::fromLocalFile(file).toEncoded() );
+}
+
+static QString thumbName(const QString &uri) {
+    return QString::fromLatin1( QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5).toHex() )+".png";
+}
+
+static void makeDir(QString dir) {
+    if(QFile::exists(dir)) {
+        return;
+    }
+    QDir D;
+    D.mkpath(dir);
+    QFile::setPermissions(dir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner); //private to the user (spec)
+}
+
+static void saveThumb(QString path, QImage img) {
+    makeDir(path.section("/",0,-2));
+    QSaveFile out(path); //written to a temporary file and renamed - never seen half-written by other apps
+    if(!out.open(QIODevice::WriteOnly) || !img.save(&out, "PNG")) {
+        out.cancelWriting();
+        return;
+    }
+    if(out.commit()) {
+        QFile::setPermissions(path, QFile::ReadOwner | QFile::WriteOwner);
+    }
+}
+
+LThumbnailer* LThumbnailer::instance() {
+    static LThumbnailer thumbs;
+    return &thumbs;
+}
+
+//Static lookups
+QString LThumbnailer::cachedThumbnail(QString file, int size) {
+    QFileInfo info(file);
+    if(!info.isFile()) {
+        return "";
+    }
+    QString uri = fileURI(info.absoluteFilePath());
+    QString path = thumbDir()+(flavorSize(size)>128 ? "/large/" : "/normal/")+thumbName(uri);
+    if(isCurrent(path, uri, info.lastModified().toSecsSinceEpoch())) {
+        return path;
+    }
+    return "";
+}
+
+QImage LThumbnailer::thumbnail(QString file, int size) {
+    QFileInfo info(file);
+    if(!info.isFile()) {
+        return QImage();
+    }
+    QString base = thumbDir();
+    int fsize = flavorSize(size);
+    QString uri = fileURI(info.absoluteFilePath());
+    QString name = thumbName(uri);
+    qint64 mtime = info.lastModified().toSecsSinceEpoch();
+    QString path = base+(fsize>128 ? "/large/" : "/normal/")+name;
+    QString failpath = base+"/fail/7b7b-"+LDesktopUtils::LuminaDesktopVersion()+"/"+name;
+    //Already have one (from us or anybody else)?
+    if(isCurrent(path, uri, mtime)) {
+        QImage img(path);
+        if(!img.isNull()) {
+            return img;
+        }
+    }
+    if(isCurrent(failpath, uri, mtime)) {
+        return QImage();    //tried this version of the file already
+    }
+    //Generate it - decode straight to the thumbnail size
+    QImageReader reader(info.absoluteFilePath());
+    reader.setAutoTransform(true);
+    QSize full = reader.size();
+    if(full.isValid() && (full.width()>fsize || full.height()>fsize) ) {
+        reader.setScaledSize( full.scaled(fsize, fsize, Qt::KeepAspectRatio) );
+    }
+    QImage img = reader.read();
+    bool inCache = info.absoluteFilePath().startsWith(base+"/"); //never make thumbnails of thumbnails (spec)
+    if(img.isNull()) {
+        if(!inCache) {
+            //Leave a note so this does not get tried again until the file changes
+            QImage fail(1, 1, QImage::Format_ARGB32);
+            fail.fill(Qt::transparent);
+            fail.setText("Thumb::URI", uri);
+            fail.setText("Thumb::MTime", QString::number(mtime));
+            saveThumb(failpath, fail);
+        }
+        return QImage();
+    }
+    if(img.width()>fsize || img.height()>fsize) {
+        img = img.scaled(fsize, fsize, Qt::KeepAspectRatio, Qt::SmoothTransformation);    //format without scaled reads
+    }
+    if(!inCache) {
+        img.setText("Thumb::URI", uri);
+        img.setText("Thumb::MTime", QString::number(mtime));
+        img.setText("Thumb::Size", QString::number(info.size()));
+        if(full.isValid()) {
+            img.setText("Thumb::Image::Width", QString::number(full.width()));
+            img.setText("Thumb::Image::Height", QString::number(full.height()));
+        }
+        img.setText("Software", "7b7b "+LDesktopUtils::LuminaDesktopVersion());
+        saveThumb(path, img);
+    }
+    return img;
+}
+
+// === PUBLIC ===
+void LThumbnailer::requestThumbnail(QString file, int size) {
+    int fsize = flavorSize(size);
+    QString id = QString::number(fsize)+":"+file;
+    if(pending.contains(id)) {
+        return;    //already on the way
+    }
+    pending << id;
+    QtConcurrent::run(POOL, [=] {
+        this->emit InternalThumbnailDone(file, fsize, LThumbnailer::thumbnail(file, fsize));
+    });
+}
+
+// === PRIVATE ===
+LThumbnailer::LThumbnailer() : QObject() {
+    //Separate threads so a big batch of images does not hold up anything else
+    POOL = new QThreadPool(this);
+    POOL->setMaxThreadCount( qBound(1, QThread::idealThreadCount()/2, 4) );
+    connect(this, SIGNAL(InternalThumbnailDone(QString, int, QImage)), this, SLOT(ThumbnailDone(QString, int, QImage)) );
+}
+
+LThumbnailer::~LThumbnailer() {
+    POOL->clear();
+    POOL->waitForDone();
+}
+
+int LThumbnailer::flavorSize(int size) {
+    return (size>128) ? 256 : 128;
+}
+
+QString LThumbnailer::thumbDir() {
+    QString dir = QString(getenv("XDG_CACHE_HOME")).section(":",0,0);
+    if(dir.isEmpty()) {
+        dir = QDir::homePath()+"/.cache";
+    }
+    return dir+"/thumbnails";
+}
+
+bool LThumbnailer::isCurrent(QString thumbfile, const QString &uri, qint64 mtime) {
+    //Only the PNG text chunks get read here - not the image itself
+    QImageReader reader(thumbfile, "png");
+    if(!reader.canRead()) {
+        return false;
+    }
+    return (reader.text("Thumb::URI")==uri && reader.text("Thumb::MTime").toLongLong()==mtime);
+}
+
+// === PRIVATE SLOTS ===
+void LThumbnailer::ThumbnailDone(QString file, int size, QImage img) {
+    pending.remove(QString::number(size)+":"+file);
+    if(img.isNull()) {
+        this->emit ThumbnailFailed(file);
+    }
+    else {
+        this->emit ThumbnailReady(file, img);
+    }
+}
@@ -0,0 +1,59 @@
+//===========================================
+//  7b7b source code
+//  Available under the 3-clause BSD license
+//  See the LICENSE file for full details
+//===========================================
+// This is a thumbnail service for image files following the freedesktop
+//  thumbnail spec: thumbnails live in $XDG_CACHE_HOME/thumbnails/{normal,large}
+//  named after the MD5 of the file URI, and are only used while their
+//  Thumb::URI/Thumb::MTime match the file. That directory is shared with the
+//  file managers/image viewers of other desktops, so any thumbnail they
+//  already made gets re-used and the ones made here are available to them.
+//  Missing thumbnails get generated on a separate (small) thread pool, decoding
+//  the image straight to the thumbnail size.
+//===========================================
+#ifndef _LUMINA_LIBRARY_THUMBNAILER_H
+#define _LUMINA_LIBRARY_THUMBNAILER_H
+
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+class LThumbnailer : public QObject {
+    Q_OBJECT
+public:
+    static LThumbnailer* instance();
+
+    //Path of an up-to-date thumbnail for the file (empty if there is none yet - nothing gets generated)
+    // size: the size it will be shown at (device pixels) - picks the "normal" (128px) or "large" (256px) set
+    static QString cachedThumbnail(QString file, int size);
+    //Thumbnail for a file (read/generated in this thread - null image if the file cannot be read)
+    static QImage thumbnail(QString file, int size);
+
+    //Background version: ThumbnailReady() or ThumbnailFailed() gets emitted for the file later on
+    // (several requests for the same file/size before then only give one result)
+    void requestThumbnail(QString file, int size);
+
+private:
+    LThumbnailer();
+    ~LThumbnailer();
+
+    QThreadPool *POOL;
+    QSet<QString> pending; //"<flavor size>:<file>" for the requests still running
+
+    static int flavorSize(int size); //128 (normal) or 256 (large)
+    static QString thumbDir(); //base dir (no trailing "/")
+    static bool isCurrent(QString thumbfile, const QString &uri, qint64 mtime);
+
+private slots:
+    void ThumbnailDone(QString file, int size, QImage img);
+
+signals:
+    void InternalThumbnailDone(QString, int, QImage); //INTERNAL SIGNAL - DO NOT USE in other classes/objects
+    void ThumbnailReady(QString, QImage); //file, thumbnail (no larger than the flavor size)
+    void ThumbnailFailed(QString); //file could not be thumbnailed
+};
+
+#endif
@@ -8,6 +8,7 @@
 
 #include "LuminaOS.h"
 #include "LuminaXDG.h"
+#include "LPathResolver.h"
 
 #include <QApplication>
 #include <QtConcurrent>
@@ -200,12 +201,9 @@ bool LUtils::isValidBinary(QString& bin) {
     //Now look for relative/absolute path
     if(!bin.startsWith("/")) {
         //Relative path: search for it on the current "PATH" settings
-        QStringList paths = QString(qgetenv("PATH")).split(":");
-        for(int i=0; i<paths.length(); i++) {
-            if(QFile::exists(paths[i]+"/"+bin)) {
-                bin = paths[i]+"/"+bin;
-                break;
-            }
+        QString path = LPathResolver::instance()->resolve(bin);
+        if(!path.isEmpty()) {
+            bin = path;
         }
     }
     //bin should be the full path by now
@@ -7,11 +7,24 @@
 #include "LuminaXDG.h"
 #include "LuminaOS.h"
 #include "LUtils.h"
+#include "LDesktopIndex.h"
+#include "LIconSharedCache.h"
+#include "LMimeApps.h"
+#include "LMimeComments.h"
+#include "LMimeDatabase.h"
+#include "LMimeGlobs.h"
+#include "LPathResolver.h"
 #include <QObject>
 #include <QTimer>
+#include <QSet>
+#include <QAtomicInteger>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
 
-static QStringList mimeglobs;
-static qint64 mimechecktime;
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 //=============================
 //  XDGDesktop CLASS
@@ -25,12 +38,328 @@ XDGDesktop::XDGDesktop(QString file, QObject *parent)
     useTerminal=false;
     startupNotify=false;
     useVGL = false;
+    localeComplete = true;
+    localeCharge = 0;
+    execMemo.store(0);
     type = XDGDesktop::BAD;
     if(!filePath.isEmpty()) {
         sync();    //if an input file is given - go ahead and sync now
     }
 }
 
+//Keys recognized within *.desktop files
+enum desktop_key { KEY_UNKNOWN, KEY_NAME, KEY_GENERICNAME, KEY_COMMENT, KEY_ICON, KEY_TRYEXEC, KEY_EXEC, KEY_PATH,
+                   KEY_NODISPLAY, KEY_HIDDEN, KEY_CATEGORIES, KEY_ONLYSHOWIN, KEY_NOTSHOWIN, KEY_TERMINAL, KEY_ACTIONS,
+                   KEY_MIMETYPE, KEY_KEYWORDS, KEY_STARTUPNOTIFY, KEY_STARTUPWMCLASS, KEY_URL, KEY_TYPE
+                 };
+
+//Dispatch on the key length first so each key costs at most a couple of memcmp() calls
+static desktop_key lookupDesktopKey(const char *key, int len) {
+#define KEY_IS(str) (memcmp(key, str, len)==0)
+    switch(len) {
+    case 3:
+        if(KEY_IS("URL")) {
+            return KEY_URL;
+        }
+        break;
+    case 4:
+        if(KEY_IS("Name")) {
+            return KEY_NAME;
+        }
+        else if(KEY_IS("Exec")) {
+            return KEY_EXEC;
+        }
+        else if(KEY_IS("Icon")) {
+            return KEY_ICON;
+        }
+        else if(KEY_IS("Type")) {
+            return KEY_TYPE;
+        }
+        else if(KEY_IS("Path")) {
+            return KEY_PATH;
+        }
+        break;
+    case 6:
+        if(KEY_IS("Hidden")) {
+            return KEY_HIDDEN;
+        }
+        break;
+    case 7:
+        if(KEY_IS("Comment")) {
+            return KEY_COMMENT;
+        }
+        else if(KEY_IS("TryExec")) {
+            return KEY_TRYEXEC;
+        }
+        else if(KEY_IS("Actions")) {
+            return KEY_ACTIONS;
+        }
+        break;
+    case 8:
+        if(KEY_IS("Keywords")) {
+            return KEY_KEYWORDS;
+        }
+        else if(KEY_IS("MimeType")) {
+            return KEY_MIMETYPE;
+        }
+        else if(KEY_IS("Terminal")) {
+            return KEY_TERMINAL;
+        }
+        break;
+    case 9:
+        if(KEY_IS("NoDisplay")) {
+            return KEY_NODISPLAY;
+        }
+        else if(KEY_IS("NotShowIn")) {
+            return KEY_NOTSHOWIN;
+        }
+        break;
+    case 10:
+        if(KEY_IS("Categories")) {
+            return KEY_CATEGORIES;
+        }
+        else if(KEY_IS("OnlyShowIn")) {
+            return KEY_ONLYSHOWIN;
+        }
+        break;
+    case 11:
+        if(KEY_IS("GenericName")) {
+            return KEY_GENERICNAME;
+        }
+        break;
+    case 13:
+        if(KEY_IS("StartupNotify")) {
+            return KEY_STARTUPNOTIFY;
+        }
+        break;
+    case 14:
+        if(KEY_IS("StartupWMClass")) {
+            return KEY_STARTUPWMCLASS;
+        }
+        break;
+    }
+#undef KEY_IS
+    return KEY_UNKNOWN;
+}
+
+static inline bool isSpaceByte(char c) {
+    return (c==' ' || c=='\t' || c=='\r' || c=='\n' || c=='\v' || c=='\f');
+}
+
+static inline void trimSpan(const char *&start, const char *&end) {
+    while(start<end && isSpaceByte(*start)) {
+        start++;
+    }
+    while(end>start && isSpaceByte(*(end-1))) {
+        end--;
+    }
+}
+
+static inline bool spanEquals(const char *start, const char *end, const QByteArray &str) {
+    return ( (end-start)==str.size() && memcmp(start, str.constData(), str.size())==0 );
+}
+
+static inline bool spanIsTrue(const char *start, const char *end) {
+    return ( (end-start)==4 && qstrnicmp(start, "true", 4)==0 );
+}
+
+//Decode a (trimmed) value - only collapse internal whitespace when there is something to collapse
+static QString spanToString(const char *start, const char *end) {
+    bool simple = true;
+    for(const char *p = start; p<end && simple; p++) {
+        if(isSpaceByte(*p)) {
+            simple = (*p==' ') && !(p+1<end && isSpaceByte(*(p+1)));
+        }
+    }
+    QString out = QString::fromUtf8(start, end-start);
+    return (simple ? out : out.simplified());
+}
+
+//Localization table: packed records of <key byte><action ID>\0<locale>\0<value>\0
+// (raw UTF-8 straight from the file - only decoded when a locale gets applied)
+static void addLocaleRecord(QByteArray &table, desktop_key key, const QString &action, const char *locstart, const char *locend, const char *vstart, const char *vend) {
+    table.append((char) key);
+    table.append(action.toUtf8());
+    table.append('\0');
+    table.append(locstart, locend-locstart);
+    table.append('\0');
+    table.append(vstart, vend-vstart);
+    table.append('\0');
+}
+
+static QString activelocale;
+static QMutex activelocalemutex;
+static QAtomicInteger<qint64> localebytes(0); //total size of all the kept localization tables
+static qint64 localebudget = 4*1024*1024;
+
+XDGDesktop::~XDGDesktop() {
+    localebytes.fetchAndAddRelaxed(-localeCharge);
+}
+
+QString XDGDesktop::activeLocale() {
+    QMutexLocker lock(&activelocalemutex);
+    if(activelocale.isEmpty()) {
+        activelocale = QLocale::system().name();
+    }
+    return activelocale;
+}
+
+void XDGDesktop::setActiveLocale(QString locale) {
+    QMutexLocker lock(&activelocalemutex);
+    activelocale = locale;
+}
+
+qint64 XDGDesktop::localeDataSize() {
+    return localebytes.loadRelaxed();
+}
+
+void XDGDesktop::setLocaleBudget(qint64 bytes) {
+    localebudget = bytes;
+}
+
+void XDGDesktop::setLocaleData(const QByteArray &table, bool complete) {
+    localebytes.fetchAndAddRelaxed(-localeCharge);
+    localeCharge = 0;
+    localeTable.clear();
+    if(!table.isEmpty() && localebytes.loadRelaxed()+table.size() > localebudget) {
+        complete = false; //over budget - a locale switch will need to re-read this file
+    } else if(!table.isEmpty()) {
+        localeTable = table;
+        localeCharge = localeTable.size();
+        localebytes.fetchAndAddRelaxed(localeCharge);
+    }
+    localeComplete = complete;
+}
+
+XDGDesktop* XDGDesktop::clone() {
+    XDGDesktop *desk = new XDGDesktop("");
+    desk->filePath = filePath;
+    desk->lastRead = lastRead;
+    desk->type = type;
+    desk->name = name;
+    desk->genericName = genericName;
+    desk->comment = comment;
+    desk->icon = icon;
+    desk->showInList = showInList;
+    desk->notShowInList = notShowInList;
+    desk->isHidden = isHidden;
+    desk->exec = exec;
+    desk->tryexec = tryexec;
+    desk->path = path;
+    desk->startupWM = startupWM;
+    desk->actionList = actionList;
+    desk->mimeList = mimeList;
+    desk->catList = catList;
+    desk->keyList = keyList;
+    desk->useTerminal = useTerminal;
+    desk->startupNotify = startupNotify;
+    desk->actions = actions;
+    desk->useVGL = useVGL;
+    desk->url = url;
+    //The table itself is implicitly shared - only count it once (the copy is the one which stays around)
+    desk->localeTable = localeTable;
+    desk->localeComplete = localeComplete;
+    desk->localeCharge = localeCharge;
+    localeCharge = 0;
+    return desk;
+}
+
+void XDGDesktop::applyLocale(const QByteArray &table, const QByteArray &lang) {
+    QByteArray slang = lang.contains('_') ? lang.left(lang.indexOf('_')) : lang; //short lang code
+    //Find the best value for each field: exact locale > short locale > unlocalized (first one wins on ties)
+    struct pick {
+        int rank;
+        const char *start, *end;
+    };
+    QHash<QByteArray, pick> best; //<key byte><action ID>
+    const char *ptr = table.constData();
+    const char *end = ptr+table.size();
+    while(ptr<end) {
+        const char *rec = ptr;
+        const char *aidend = (const char*) memchr(rec+1, 0, end-rec-1);
+        const char *locend = (aidend==0) ? 0 : (const char*) memchr(aidend+1, 0, end-aidend-1);
+        const char *valend = (locend==0) ? 0 : (const char*) memchr(locend+1, 0, end-locend-1);
+        if(valend==0) {
+            break;    //truncated table
+        }
+        ptr = valend+1;
+        const char *loc = aidend+1;
+        int rank = 0;
+        if(loc==locend) {
+            rank = 1;
+        } else if(spanEquals(loc, locend, lang)) {
+            rank = 3;
+        } else if(spanEquals(loc, locend, slang)) {
+            rank = 2;
+        }
+        if(rank==0) {
+            continue;
+        }
+        QByteArray id(rec, aidend-rec);
+        QHash<QByteArray, pick>::const_iterator it = best.constFind(id);
+        if(it==best.constEnd() || rank>it.value().rank) {
+            pick p;
+            p.rank = rank;
+            p.start = locend+1;
+            p.end = valend;
+            best.insert(id, p);
+        }
+    }
+    name.clear();
+    genericName.clear();
+    comment.clear();
+    keyList.clear();
+    for(int i=0; i<actions.length(); i++) {
+        actions[i].name.clear();
+    }
+    for(QHash<QByteArray, pick>::const_iterator it = best.constBegin(); it!=best.constEnd(); ++it) {
+        desktop_key key = (desktop_key) it.key().at(0);
+        QString val = spanToString(it.value().start, it.value().end);
+        if(it.key().length()>1) {
+            //Desktop action name
+            QString aid = QString::fromUtf8(it.key().constData()+1, it.key().length()-1);
+            for(int i=0; i<actions.length(); i++) {
+                if(actions[i].ID==aid) {
+                    actions[i].name = val;
+                }
+            }
+            continue;
+        }
+        switch(key) {
+        case KEY_NAME:
+            name = val;
+            break;
+        case KEY_GENERICNAME:
+            genericName = val;
+            break;
+        case KEY_COMMENT:
+            comment = val;
+            break;
+        case KEY_KEYWORDS:
+            keyList = val.split(";",Qt::SkipEmptyParts);
+            break;
+        default:
+            break;
+        }
+    }
+    //If there are OnlyShowIn desktops listed, add them to the name
+    if( !showInList.isEmpty() && !showInList.contains("7b7b", Qt::CaseInsensitive) ) {
+        name.append(" ("+showInList.join(", ")+")");
+    }
+}
+
+bool XDGDesktop::relabel(QString locale) {
+    if(!localeComplete) {
+        return false;    //translations were not kept - need to re-read the file
+    }
+    if(localeTable.isEmpty()) {
+        return true;    //nothing translated in this file
+    }
+    applyLocale(localeTable, locale.toUtf8());
+    compact();
+    return true;
+}
+
 void XDGDesktop::sync() {
     //Reset internal vars
     isHidden=false;
@@ -38,213 +367,236 @@ void XDGDesktop::sync() {
     startupNotify=false;
     type = XDGDesktop::BAD;
     exec = tryexec = "";
+    actions.clear(); //appended to while reading
     //Read in the File
     if(!filePath.endsWith(".desktop")) {
         return;
     }
     lastRead = QDateTime::currentDateTime();
-    QStringList file = LUtils::readFile(filePath);
-    if(file.isEmpty()) {
+    //Map the file and walk the raw bytes in a single pass (values are only decoded for keys which are used)
+    QFile file(filePath);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QByteArray buffer;
+    qint64 size = file.size();
+    const char *data = 0;
+    uchar *mapped = (size>0) ? file.map(0, size) : 0;
+    if(mapped!=0) {
+        data = (const char*) mapped;
+    } else {
+        buffer = file.readAll(); //could not map (special filesystem?) - just read it
+        data = buffer.constData();
+        size = buffer.size();
+    }
+    if(size<=0) {
         return;    //done with init right here - nothing to load
     }
     //Get the current localization code
     type = XDGDesktop::APP; //assume this initially if we read the file properly
-    QString lang = QLocale::system().name(); //lang code
-    QString slang = lang.section("_",0,0); //short lang code
+    QByteArray lang = XDGDesktop::activeLocale().toUtf8(); //lang code
+    QByteArray slang = lang.contains('_') ? lang.left(lang.indexOf('_')) : lang; //short lang code
     //Now start looping over the information
     XDGDesktopAction CDA; //current desktop action
+    QByteArray loctable; //every Name/GenericName/Comment/Keywords value (see addLocaleRecord())
+    bool hasloc = false; //any localized values in the table
     bool insection=false;
     bool inaction=false;
-    for(int i=0; i<file.length(); i++) {
-        QString line = file[i];
-        //if(filePath.contains("pcbsd")){ qDebug() << " - Check Line:" << line << inaction << insection; }
-        //Check if this is the end of a section
-        if(line.startsWith("[") && inaction) {
-            insection=false;
-            inaction=false;
-            //Add the current Action structure to the main desktop structure if appropriate
-            if(!CDA.ID.isEmpty()) {
+    const char *end = data+size;
+    const char *line = data;
+    if(size>=3 && memcmp(data, "\xEF\xBB\xBF", 3)==0) {
+        line += 3;    //skip the UTF-8 BOM
+    }
+    for(const char *next = line; line<end; line = next) {
+        const char *eol = (const char*) memchr(line, '\n', end-line);
+        if(eol==0) {
+            eol = end;
+        }
+        next = (eol<end) ? eol+1 : end;
+        const char *lend = eol;
+        if(lend>line && *(lend-1)=='\r') {
+            lend--;
+        }
+        //Check if this is the end/beginning of a section
+        if(line<lend && *line=='[') {
+            if(inaction && !CDA.ID.isEmpty()) {
+                //Add the current Action structure to the main desktop structure if appropriate
                 actions << CDA;
                 CDA = XDGDesktopAction();
             }
-        } else if(line.startsWith("[")) {
             insection=false;
-            inaction = false;
+            inaction=false;
+            int len = lend-line;
+            if(len==15 && memcmp(line, "[Desktop Entry]", 15)==0) {
+                insection=true;
+            } else if(len>=16 && memcmp(line, "[Desktop Action ", 16)==0) {
+                //Grab the ID of the action out of the label
+                const char *idstart = line+16;
+                const char *idend = (const char*) memchr(idstart, ']', lend-idstart);
+                if(idend==0) {
+                    idend = lend;
+                }
+                trimSpan(idstart, idend);
+                CDA.ID = spanToString(idstart, idend);
+                inaction = true;
+            }
+            continue;
         }
-        //Now check if this is the beginning of a section
-        if(line=="[Desktop Entry]") {
-            insection=true;
+        if( (!insection && !inaction) || (line<lend && *line=='#') ) {
             continue;
         }
-        else if(line.startsWith("[Desktop Action ")) {
-            //Grab the ID of the action out of the label
-            CDA.ID = line.section("]",0,0).section("Desktop Action",1,1).simplified();
-            inaction = true;
+        //Split the line: <key>[<locale>]=<value>
+        const char *eq = (const char*) memchr(line, '=', lend-line);
+        if(eq==0) {
             continue;
-        } else if( (!insection && !inaction) || line.startsWith("#")) {
+        }
+        const char *kstart = line, *kend = eq;
+        const char *locstart = 0, *locend = 0; // localization
+        trimSpan(kstart, kend);
+        const char *br = (const char*) memchr(kstart, '[', kend-kstart);
+        if(br!=0) {
+            locstart = br+1;
+            locend = (const char*) memchr(locstart, ']', kend-locstart);
+            if(locend==0) {
+                locend = kend;
+            }
+            trimSpan(locstart, locend);
+            kend = br;
+            trimSpan(kstart, kend);
+        }
+        desktop_key key = lookupDesktopKey(kstart, kend-kstart);
+        if(key==KEY_UNKNOWN) {
             continue;
         }
-        //Now parse out the file
-        line = line.simplified();
-        QString var = line.section("=",0,0).simplified();
-        QString loc = var.section("[",1,1).section("]",0,0).simplified(); // localization
-        var = var.section("[",0,0).simplified(); //remove the localization
-        QString val = line.section("=",1,50).simplified();
-        if( val.count("\"")==2 && val.startsWith("\"") && val.endsWith("\"")) {
-            val.chop(1);    //remove the starting/ending quotes
-            val = val.remove(0,1);
+        bool noloc = (locstart==locend);
+        bool islang = !noloc && spanEquals(locstart, locend, lang);
+        bool isslang = !noloc && spanEquals(locstart, locend, slang);
+        const char *vstart = eq+1, *vend = lend;
+        trimSpan(vstart, vend);
+        if( (vend-vstart)>=2 && *vstart=='"' && *(vend-1)=='"' && memchr(vstart+1, '"', vend-vstart-2)==0 ) {
+            vstart++;    //remove the starting/ending quotes
+            vend--;
         }
         //-------------------
-        if(var=="Name") {
-            if(insection) {
-                if(loc==slang) {
-                    name = val;   //short locale code
+        switch(key) {
+        case KEY_NAME:
+        case KEY_GENERICNAME:
+        case KEY_COMMENT:
+        case KEY_KEYWORDS:
+            //Localized fields: keep every translation (the active locale gets picked below)
+            if(insection || (inaction && key==KEY_NAME)) {
+                addLocaleRecord(loctable, key, inaction ? CDA.ID : QString(), locstart, locend, vstart, vend);
+                hasloc = hasloc || !noloc;
+            }
+            break;
+        case KEY_ICON: {
+            QString *target = insection ? &icon : (inaction ? &CDA.icon : 0);
+            if(target!=0 && ( (target->isEmpty() && (noloc || isslang)) || islang) ) {
+                QString val = spanToString(vstart, vend);
+                //Quick fix for bad-registrations which add the icon suffix for theme icons
+                if(!val.startsWith("/") && val.endsWith(".png") ) {
+                    val = val.section(".",0,-2);
                 }
-                else if(loc==lang) {
-                    name = val;
-                }
-                else if(name.isEmpty() && loc.isEmpty()) {
-                    /*qDebug() << "Empty" << val;*/ name = val;
-                }
-            } else if(inaction) {
-                if(CDA.name.isEmpty() && loc.isEmpty()) {
-                    CDA.name = val;
-                }
-                else if(CDA.name.isEmpty() && loc==slang) {
-                    CDA.name = val;    //short locale code
-                }
-                else if(loc == lang) {
-                    CDA.name = val;
-                }
-            }
-            //hasName = true;
-        } else if(var=="GenericName" && insection) {
-            if(genericName.isEmpty() && loc.isEmpty()) {
-                genericName = val;
+                *target = val;
             }
-            else if(genericName.isEmpty() && loc==slang) {
-                genericName = val;    //short locale code
+            break;
+        }
+        case KEY_TRYEXEC:
+            if(insection && tryexec.isEmpty()) {
+                tryexec = spanToString(vstart, vend);
             }
-            else if(loc == lang) {
-                genericName = val;
+            break;
+        case KEY_EXEC:
+            if(insection && exec.isEmpty() ) {
+                exec = spanToString(vstart, vend);
             }
-        } else if(var=="Comment" && insection) {
-            if(comment.isEmpty() && loc.isEmpty()) {
-                comment = val;
+            else if(inaction && CDA.exec.isEmpty() ) {
+                CDA.exec = spanToString(vstart, vend);
             }
-            else if(comment.isEmpty() && loc==slang) {
-                comment = val;    //short locale code
+            break;
+        case KEY_PATH:
+            if(insection && path.isEmpty()) {
+                path = spanToString(vstart, vend);
             }
-            else if(loc == lang) {
-                comment = val;
+            break;
+        case KEY_NODISPLAY:
+        case KEY_HIDDEN:
+            if(insection && !isHidden) {
+                isHidden = spanIsTrue(vstart, vend);
             }
-        } else if(var=="Icon") {
-            //Quick fix for bad-registrations which add the icon suffix for theme icons
-            if(!val.startsWith("/") && val.endsWith(".png") ) {
-                val = val.section(".",0,-2);
+            break;
+        case KEY_CATEGORIES:
+            if(insection) {
+                catList = spanToString(vstart, vend).split(";",Qt::SkipEmptyParts);
             }
+            break;
+        case KEY_ONLYSHOWIN:
             if(insection) {
-                if(icon.isEmpty() && loc.isEmpty()) {
-                    icon = val;
-                }
-                else if(icon.isEmpty() && loc==slang) {
-                    icon = val;    //short locale code
-                }
-                else if(loc == lang) {
-                    icon = val;
-                }
-            } else if(inaction) {
-                if(CDA.icon.isEmpty() && loc.isEmpty()) {
-                    CDA.icon = val;
-                }
-                else if(CDA.icon.isEmpty() && loc==slang) {
-                    CDA.icon = val;    //short locale code
-                }
-                else if(loc == lang) {
-                    CDA.icon = val;
-                }
+                showInList = spanToString(vstart, vend).split(";",Qt::SkipEmptyParts);
             }
-        }
-        else if( (var=="TryExec") && (tryexec.isEmpty()) && insection) {
-            tryexec = val;
-        }
-        else if(var=="Exec") {
-            if(insection && exec.isEmpty() ) {
-                exec = val;
+            break;
+        case KEY_NOTSHOWIN:
+            if(insection) {
+                notShowInList = spanToString(vstart, vend).split(";",Qt::SkipEmptyParts);
             }
-            else if(inaction && CDA.exec.isEmpty() ) {
-                CDA.exec = val;
+            break;
+        case KEY_TERMINAL:
+            if(insection) {
+                useTerminal = spanIsTrue(vstart, vend);
             }
-        }
-        else if( (var=="Path") && (path.isEmpty() ) && insection) {
-            path = val;
-        }
-        else if(var=="NoDisplay" && !isHidden && insection) {
-            isHidden = (val.toLower()=="true");
-        }
-        else if(var=="Hidden" && !isHidden && insection) {
-            isHidden = (val.toLower()=="true");
-        }
-        else if(var=="Categories" && insection) {
-            catList = val.split(";",Qt::SkipEmptyParts);
-        }
-        else if(var=="OnlyShowIn" && insection) {
-            showInList = val.split(";",Qt::SkipEmptyParts);
-        }
-        else if(var=="NotShowIn" && insection) {
-            notShowInList = val.split(";",Qt::SkipEmptyParts);
-        }
-        else if(var=="Terminal" && insection) {
-            useTerminal= (val.toLower()=="true");
-        }
-        else if(var=="Actions" && insection) {
-            actionList = val.split(";",Qt::SkipEmptyParts);
-        }
-        else if(var=="MimeType" && insection) {
-            mimeList = val.split(";",Qt::SkipEmptyParts);
-        }
-        else if(var=="Keywords" && insection) {
-            if(keyList.isEmpty() && loc.isEmpty()) {
-                keyList = val.split(";",Qt::SkipEmptyParts);
+            break;
+        case KEY_ACTIONS:
+            if(insection) {
+                actionList = spanToString(vstart, vend).split(";",Qt::SkipEmptyParts);
             }
-            else if(loc == lang) {
-                keyList = val.split(";",Qt::SkipEmptyParts);
+            break;
+        case KEY_MIMETYPE:
+            if(insection) {
+                mimeList = spanToString(vstart, vend).split(";",Qt::SkipEmptyParts);
             }
-        }
-        else if(var=="StartupNotify" && insection) {
-            startupNotify = (val.toLower()=="true");
-        }
-        else if(var=="StartupWMClass" && insection) {
-            startupWM = val;
-        }
-        else if(var=="URL" && insection) {
-            url = val;
-        }
-        else if(var=="Type" && insection) {
-            if(val.toLower()=="application") {
-                type = XDGDesktop::APP;
+            break;
+        case KEY_STARTUPNOTIFY:
+            if(insection) {
+                startupNotify = spanIsTrue(vstart, vend);
             }
-            else if(val.toLower()=="link") {
-                type = XDGDesktop::LINK;
+            break;
+        case KEY_STARTUPWMCLASS:
+            if(insection) {
+                startupWM = spanToString(vstart, vend);
             }
-            else if(val.toLower().startsWith("dir")) {
-                type = XDGDesktop::DIR;    //older specs are "Dir", newer specs are "Directory"
+            break;
+        case KEY_URL:
+            if(insection) {
+                url = spanToString(vstart, vend);
             }
-            else {
-                type = XDGDesktop::BAD;    //Unknown type
+            break;
+        case KEY_TYPE:
+            if(insection) {
+                int len = vend-vstart;
+                if(len==11 && qstrnicmp(vstart, "application", 11)==0) {
+                    type = XDGDesktop::APP;
+                }
+                else if(len==4 && qstrnicmp(vstart, "link", 4)==0) {
+                    type = XDGDesktop::LINK;
+                }
+                else if(len>=3 && qstrnicmp(vstart, "dir", 3)==0) {
+                    type = XDGDesktop::DIR;    //older specs are "Dir", newer specs are "Directory"
+                }
+                else {
+                    type = XDGDesktop::BAD;    //Unknown type
+                }
             }
+            break;
+        default:
+            break;
         }
     } //end reading file
     if(!CDA.ID.isEmpty()) {
         actions << CDA;    //if an action was still being read, add that to the list now
-        //CDA = XDGDesktopAction();
-    }
-
-    file.clear(); //done with contents of file
-    //If there are OnlyShowIn desktops listed, add them to the name
-    if( !showInList.isEmpty() && !showInList.contains("7b7b", Qt::CaseInsensitive) ) {
-        name.append(" ("+showInList.join(", ")+")");
     }
+    //Pick the values for the active locale (the table is only kept if something is actually translated)
+    applyLocale(loctable, lang);
+    setLocaleData(hasloc ? loctable : QByteArray(), true);
     //Quick fix for showing "wine" applications (which quite often don't list a category, or have other differences)
     if(catList.isEmpty() && filePath.contains("/wine/")) {
         catList << "Wine"; //Internal 7b7b category only (not in XDG specs as of 11/14/14)
@@ -263,9 +615,74 @@ void XDGDesktop::sync() {
             }
         }
     }
+    compact();
+}
 
+//Shared pool for strings which repeat across many entries (categories, mimetypes, keywords...)
+// QString is implicitly shared, so every entry holding a pooled string points at the same data
+// Strings only the pool still holds get dropped whenever the pool has doubled in size since the last pass
+static QSet<QString> stringpool;
+static QMutex stringpoolmutex;
+static int stringpoolpruned = 0; //size of the pool after the last pass
+
+static void pruneStrings() {
+    //stringpoolmutex must already be locked (nobody can pick up an unshared string in the meantime)
+    for(QSet<QString>::iterator it = stringpool.begin(); it!=stringpool.end(); ) {
+        if(it->data_ptr().isShared()) {
+            ++it;
+        } else {
+            it = stringpool.erase(it);    //no entry uses it any more
+        }
+    }
+    stringpoolpruned = stringpool.size();
 }
 
+static QString internString(const QString &str) {
+    if(str.isEmpty()) {
+        return QString();
+    }
+    QMutexLocker lock(&stringpoolmutex); //entries get parsed on the worker threads
+    QSet<QString>::const_iterator it = stringpool.constFind(str);
+    if(it!=stringpool.constEnd()) {
+        return *it;
+    }
+    if(stringpool.size() >= 2*stringpoolpruned + 1024) {
+        pruneStrings();
+    }
+    stringpool.insert(str);
+    return str;
+}
+
+static void internList(QStringList &list) {
+    for(int i=0; i<list.length(); i++) {
+        list[i] = internString(list[i]);
+    }
+}
+
+//Main categories in the order they are checked by LXDG::sortDesktopCats()
+static const char *maincats[] = { "AudioVideo", "Development", "Education", "Game", "Graphics", "Network", "Office", "Science", "Settings", "System", "Utility", "Wine" };
+
+void XDGDesktop::compact() {
+    internList(catList);
+    internList(mimeList);
+    internList(keyList);
+    internList(showInList);
+    internList(notShowInList);
+    internList(actionList);
+    icon = internString(icon);
+    path = internString(path);
+}
+
+quint32 XDGDesktop::categoryMask() const {
+    //Worked out from catList every time, so it can never be out of date with it (just a few string compares)
+    quint32 mask = 0;
+    for(int i=0; i<CAT_COUNT; i++) {
+        if(catList.contains(QLatin1String(maincats[i]))) {
+            mask |= (1<<i);
+        }
+    }
+    return mask;
+}
 
 bool XDGDesktop::isValid(bool showAll) {
     bool ok=true;
@@ -276,17 +693,30 @@ bool XDGDesktop::isValid(bool showAll) {
         ok=false;
         //if(DEBUG){ qDebug() << " - Bad file type"; }
         break;
-    case XDGDesktop::APP:
-        if(!tryexec.isEmpty() && !LXDG::checkExec(tryexec)) {
-            ok=false;
-        }//if(DEBUG){ qDebug() << " - tryexec does not exist";} }
-        else if(exec.isEmpty() || name.isEmpty()) {
+    case XDGDesktop::APP: {
+        QString bin = exec.section(" ",0,0,QString::SectionSkipEmpty);
+        if(tryexec.startsWith("/") || bin.startsWith("/")) {
+            //Absolute paths are not covered by the PATH watches - always checked
+            ok = (tryexec.isEmpty() || LXDG::checkExec(tryexec)) && (exec.isEmpty() || LXDG::checkExec(bin));
+        } else {
+            //The binary checks only need to be re-run when the PATH listings change
+            // (one atomic word, since entries are shared between threads through the list snapshots)
+            quint64 key = ( ((quint64) qHash(exec)) ^ (((quint64) qHash(tryexec))*31) ) & 0x7FFFFFFF;
+            quint64 want = ((LPathResolver::instance()->generation() & 0xFFFFFFFF)<<32) | (key<<1);
+            quint64 memo = execMemo.load(std::memory_order_relaxed);
+            if(memo!=0 && (memo & ~((quint64) 1))==want) {
+                ok = (memo & 1);
+            } else {
+                ok = (tryexec.isEmpty() || LXDG::checkExec(tryexec)) && (exec.isEmpty() || LXDG::checkExec(bin));
+                execMemo.store(want | (ok ? 1 : 0), std::memory_order_relaxed);
+            }
+        }
+        //if(DEBUG && !ok){ qDebug() << " - tryexec or first exec binary does not exist"; }
+        if(ok && (exec.isEmpty() || name.isEmpty()) ) {
             ok=false;
         }//if(DEBUG){ qDebug() << " - exec or name is empty";} }
-        else if(!LXDG::checkExec(exec.section(" ",0,0,QString::SectionSkipEmpty)) ) {
-            ok=false;
-        }//if(DEBUG){ qDebug() << " - first exec binary does not exist";} }
         break;
+    }
     case XDGDesktop::LINK:
         ok = !url.isEmpty();
         //if(DEBUG && !ok){ qDebug() << " - Link with missing URL"; }
@@ -791,21 +1221,84 @@ void XDGDesktop::addToMenu(QMenu *topmenu) {
 
 
 //====XDGDesktopList Functions ====
+//Dedicated pool for *.desktop parsing (kept separate from the global pool used for icons/etc)
+static QThreadPool* parsePool() {
+    static QThreadPool *pool = 0;
+    if(pool==0) {
+        pool = new QThreadPool();
+        pool->setMaxThreadCount(QThread::idealThreadCount());
+    }
+    return pool;
+}
+
+void XDGDesktopList::setParseThreads(int max) {
+    //max<1: use one thread per core
+    parsePool()->setMaxThreadCount( (max<1) ? QThread::idealThreadCount() : max );
+}
+
+int XDGDesktopList::parseThreads() {
+    return parsePool()->maxThreadCount();
+}
+
 XDGDesktopList::XDGDesktopList(QObject *parent, bool watchdirs) : QObject(parent) {
-    synctimer = new QTimer(this); //interval set automatically based on changes/interactions
-    connect(synctimer, SIGNAL(timeout()), this, SLOT(updateList()) );
+    synctimer = new QTimer(this); //used to batch up change notifications
+    synctimer->setSingleShot(true);
+    connect(synctimer, SIGNAL(timeout()), this, SLOT(processChanges()) );
     keepsynced = watchdirs;
+    fullRescan = false;
+    watcher = 0;
+    inotifyFD = -1;
+    inotifyNotifier = 0;
     if(watchdirs) {
-        watcher = new QFileSystemWatcher(this);
-        connect(watcher, SIGNAL(fileChanged(const QString&)), this, SLOT(watcherChanged()) );
-        connect(watcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(watcherChanged()) );
-    } else {
-        watcher = 0;
+        //inotify gives us the (dir, filename) of each change - so only those entries need to be re-read
+        inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(inotifyFD>=0) {
+            inotifyNotifier = new QSocketNotifier(inotifyFD, QSocketNotifier::Read, this);
+            connect(inotifyNotifier, &QSocketNotifier::activated, this, &XDGDesktopList::inotifyActivated);
+        } else {
+            qDebug() << "inotify not available - falling back on full app directory rescans";
+            watcher = new QFileSystemWatcher(this);
+            connect(watcher, SIGNAL(fileChanged(const QString&)), this, SLOT(watcherChanged()) );
+            connect(watcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(watcherChanged()) );
+        }
     }
 }
 
 XDGDesktopList::~XDGDesktopList() {
-    //nothing special to do here
+    if(inotifyFD>=0) {
+        ::close(inotifyFD);
+    }
+    //Retire everything - the entries stay valid for anyone still holding a snapshot
+    QList<XDGDesktop*> all = files.values();
+    files.clear();
+    publish(all);
+}
+
+XDGDesktopSnapshot::~XDGDesktopSnapshot() {
+    for(int i=0; i<retired.length(); i++) {
+        retired[i]->deleteLater(); //this might be the last reader on some other thread
+    }
+}
+
+XDGDesktopSnapshotPtr XDGDesktopList::snapshot() {
+    return std::atomic_load(&current);
+}
+
+void XDGDesktopList::publish(QList<XDGDesktop*> retired) {
+    std::shared_ptr<XDGDesktopSnapshot> snap(new XDGDesktopSnapshot());
+    snap->files = files; //implicitly shared - cheap
+    snap->dirs = scanDirs;
+    XDGDesktopSnapshotPtr old = std::atomic_load(&current);
+    if(old) {
+        //The old view gets cleaned up (along with the retired entries) once the last reader lets go of it
+        old->retired = retired;
+        old->next = snap;
+    } else {
+        for(int i=0; i<retired.length(); i++) {
+            retired[i]->deleteLater();
+        }
+    }
+    std::atomic_store(&current, XDGDesktopSnapshotPtr(snap));
 }
 
 XDGDesktopList* XDGDesktopList::instance() {
@@ -817,11 +1310,220 @@ XDGDesktopList* XDGDesktopList::instance() {
 }
 
 void XDGDesktopList::watcherChanged() {
-    if(synctimer->isActive()) {
-        synctimer->stop();
+    //QFileSystemWatcher does not say what changed - need a full rescan
+    fullRescan = true;
+    synctimer->start(1000); //1 second delay before check kicks off
+}
+
+void XDGDesktopList::inotifyActivated() {
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while( (len = ::read(inotifyFD, buf, sizeof(buf))) > 0 ) {
+        const struct inotify_event *ev = 0;
+        for(char *ptr = buf; ptr < buf+len; ptr += sizeof(struct inotify_event) + ev->len) {
+            ev = (const struct inotify_event*) ptr;
+            if(ev->mask & IN_Q_OVERFLOW) {
+                fullRescan = true;    //events were dropped
+                continue;
+            }
+            if(missingParents.contains(ev->wd)) {
+                //Something got created next to a missing app dir - rescan if it is (the way to) one of them
+                QString created = missingParents.value(ev->wd);
+                created = (created=="/" ? "" : created)+"/"+QString::fromLocal8Bit(ev->name);
+                for(int i=0; i<missingDirs.length() && !fullRescan; i++) {
+                    fullRescan = (missingDirs[i]==created || missingDirs[i].startsWith(created+"/"));
+                }
+                continue;
+            }
+            QString dir = watchDirs.value(ev->wd); //empty for watches we already removed
+            if(dir.isEmpty()) {
+                continue;
+            }
+            if( (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) || (ev->mask & IN_ISDIR) ) {
+                fullRescan = true;    //directory layout changed
+                continue;
+            }
+            if(ev->len==0) {
+                continue;
+            }
+            QString name = QString::fromLocal8Bit(ev->name);
+            if(!name.endsWith(".desktop")) {
+                continue;
+            }
+            change_op op = CHANGE_MODIFY;
+            if(ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                op = CHANGE_DELETE;
+            } else if(ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                op = CHANGE_CREATE;
+            }
+            pendingChanges.insert(dir+"/"+name, op); //last operation wins
+        }
+    }
+    //Let a burst of events (package installs) settle before processing
+    synctimer->start(500);
+}
+
+void XDGDesktopList::processChanges() {
+    if(fullRescan || files.isEmpty()) {
+        pendingChanges.clear();
+        updateList();
+    } else if(!pendingChanges.isEmpty()) {
+        applyChanges();
+    }
+}
+
+void XDGDesktopList::updateWatches(QStringList dirs) {
+    //App dirs which do not exist yet: watch the closest parent which does, so they get noticed once created
+    missingDirs.clear();
+    QStringList parents;
+    QStringList data = appDataDirs();
+    for(int i=0; i<data.length(); i++) {
+        if(data[i].isEmpty() || dirs.contains(data[i]+"/applications")) {
+            continue;
+        }
+        QString dir = data[i]+"/applications";
+        missingDirs << dir;
+        QString parent = dir.section("/",0,-2);
+        while(!parent.isEmpty() && !QFile::exists(parent)) {
+            parent = parent.section("/",0,-2);
+        }
+        if(parent.isEmpty()) {
+            parent = "/";
+        }
+        if(!parents.contains(parent)) {
+            parents << parent;
+        }
+    }
+    if(inotifyFD>=0) {
+        QList<int> oldparents = missingParents.keys();
+        for(int i=0; i<oldparents.length(); i++) {
+            if(!parents.contains(missingParents.value(oldparents[i]))) {
+                missingParents.remove(oldparents[i]); //remove first so the IN_IGNORED event gets skipped
+                inotify_rm_watch(inotifyFD, oldparents[i]);
+            }
+        }
+        for(int i=0; i<parents.length(); i++) {
+            if(missingParents.values().contains(parents[i])) {
+                continue;
+            }
+            int wd = inotify_add_watch(inotifyFD, parents[i].toLocal8Bit().constData(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+            if(wd>=0) {
+                missingParents.insert(wd, parents[i]);
+            }
+        }
+        QStringList current = watchDirs.values();
+        for(int i=0; i<current.length(); i++) {
+            if(!dirs.contains(current[i])) {
+                int wd = watchDirs.key(current[i]);
+                watchDirs.remove(wd); //remove first so the IN_IGNORED event gets skipped
+                inotify_rm_watch(inotifyFD, wd);
+            }
+        }
+        for(int i=0; i<dirs.length(); i++) {
+            if(current.contains(dirs[i])) {
+                continue;
+            }
+            int wd = inotify_add_watch(inotifyFD, dirs[i].toLocal8Bit().constData(), IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+            if(wd>=0) {
+                watchDirs.insert(wd, dirs[i]);
+            }
+        }
+    } else if(watcher!=0) {
+        dirs << parents; //any change in those means a full rescan anyway
+        QStringList current = watcher->directories();
+        for(int i=0; i<current.length(); i++) {
+            if(!dirs.contains(current[i])) {
+                watcher->removePath(current[i]);
+            }
+        }
+        for(int i=0; i<dirs.length(); i++) {
+            if(!current.contains(dirs[i])) {
+                watcher->addPath(dirs[i]);
+            }
+        }
+    }
+}
+
+void XDGDesktopList::applyChanges() {
+    //Only re-read the files which were reported as changed
+    QStringList paths = pendingChanges.keys();
+    QHash<QString, change_op> ops = pendingChanges;
+    pendingChanges.clear();
+    QList<XDGDesktop*> parsed;
+    QList<LDesktopIndex::FileStamp> stamps; //file state from before it was read
+    for(int i=0; i<paths.length(); i++) {
+        XDGDesktop *dFile = 0;
+        QFileInfo info(paths[i]);
+        if(ops.value(paths[i])!=CHANGE_DELETE && info.exists()) {
+            dFile = new XDGDesktop(paths[i]); //owned by the snapshots (not parented)
+        }
+        parsed << dFile;
+        stamps << LDesktopIndex::FileStamp{info.lastModified().toMSecsSinceEpoch(), info.size()};
+    }
+    QStringList added, removed, changed;
+    QStringList dirs;
+    QList<XDGDesktop*> retired;
+    hashmutex.lock();
+    bool badchanged = false; //unusable files came, went or changed (the index needs to know)
+    for(int i=0; i<paths.length(); i++) {
+        XDGDesktop *dFile = parsed[i];
+        bool had = files.contains(paths[i]);
+        badchanged = (badFiles.remove(paths[i])>0) || badchanged;
+        if(dFile!=0 && dFile->type==XDGDesktop::BAD) {
+            badFiles.insert(paths[i], stamps[i]);
+            badchanged = true;
+        }
+        if(dFile!=0 && dFile->type!=XDGDesktop::BAD) {
+            if(had) {
+                retired << files.take(paths[i]);
+                changed << paths[i];
+            } else {
+                added << paths[i];
+            }
+            files.insert(paths[i], dFile);
+        } else {
+            if(dFile!=0) {
+                dFile->deleteLater();    //bad file - discard it
+            }
+            if(had) {
+                retired << files.take(paths[i]);
+                removed << paths[i];
+            }
+        }
+        //Keep the recorded dir listing in sync for the on-disk index
+        QString dir = paths[i].section("/",0,-2);
+        QString name = paths[i].section("/",-1);
+        if(listing.contains(dir)) {
+            LDesktopIndex::DirListing &dlist = listing[dir];
+            if(dFile!=0 && !dlist.entries.contains(name)) {
+                dlist.entries << name;
+                dlist.entries.sort();
+            } else if(dFile==0) {
+                dlist.entries.removeAll(name);
+            }
+            if(!dirs.contains(dir)) {
+                dirs << dir;
+            }
+        }
+    }
+    for(int i=0; i<dirs.length(); i++) {
+        listing[dirs[i]].mtime = QFileInfo(dirs[i]).lastModified().toMSecsSinceEpoch();
+    }
+    lastCheck = QDateTime::currentDateTime();
+    removedApps = removed;
+    newApps = added;
+    bool appschanged = !(added.isEmpty() && removed.isEmpty() && changed.isEmpty());
+    if(appschanged) {
+        publish(retired);
+    }
+    if(appschanged || badchanged) {
+        LDesktopIndex::save(files, listing, badFiles);
+    }
+    hashmutex.unlock();
+    if(appschanged) {
+        qDebug() << "Auto App List Update:" << lastCheck << "Added:" << added.length() << "Removed:" << removed.length() << "Changed:" << changed.length();
+        emit appsUpdated(added, removed, changed);
     }
-    synctimer->setInterval(1000); //1 second delay before check kicks off
-    synctimer->start();
 }
 
 void XDGDesktopList::updateList() {
@@ -829,14 +1531,25 @@ void XDGDesktopList::updateList() {
     if(synctimer->isActive()) {
         synctimer->stop();
     }
-    hashmutex.lock();
+    fullRescan = false;
     QStringList appDirs = LXDG::systemApplicationDirs(); //get all system directories
-    QStringList found, newfiles; //for avoiding duplicate apps (might be files with same name in different priority directories)
+    QStringList newfiles, changedfiles, badfiles;
     QStringList oldkeys = files.keys();
+    QSet<QString> stale(oldkeys.begin(), oldkeys.end()); //keys which were not seen (yet) during this scan
     bool appschanged = false;
     bool firstrun = lastCheck.isNull() || oldkeys.isEmpty();
     lastCheck = QDateTime::currentDateTime();
-    //Variables for internal loop use only (to prevent re-initializing variable on every iteration)
+    //On the first run, try to warm-start from the on-disk index (only changed files get re-parsed)
+    LDesktopIndex index;
+    if(firstrun) {
+        index.load();
+    }
+    listing.clear();
+    bool indexchanged = false;
+    //Phase 1: enumerate the directories and collect the files which need to be (re)loaded
+    // (kept in priority-directory order so the merge below behaves exactly like a serial scan)
+    QList<desktop_job> jobs;
+    QHash<QString, LDesktopIndex::FileStamp> bad; //unusable files seen during this scan
     QString path;
     QDir dir;
     QStringList appslist;
@@ -844,35 +1557,87 @@ void XDGDesktopList::updateList() {
         if( !dir.cd(appDirs[i]) ) {
             continue;    //could not open dir for some reason
         }
-        appslist = dir.entryList(QStringList() << "*.desktop",QDir::Files, QDir::Name);
+        LDesktopIndex::DirListing dlist;
+        dlist.mtime = QFileInfo(appDirs[i]).lastModified().toMSecsSinceEpoch(); //read before listing the dir
+        if(index.isLoaded() && index.dirUnchanged(appDirs[i], dlist.mtime)) {
+            dlist.entries = index.dirEntries(appDirs[i]);
+        } else {
+            dlist.entries = dir.entryList(QStringList() << "*.desktop",QDir::Files, QDir::Name);
+            indexchanged = true;
+        }
+        listing.insert(appDirs[i], dlist);
+        appslist = dlist.entries;
         for(int a=0; a<appslist.length(); a++) {
             path = dir.absoluteFilePath(appslist[a]);
-            if(files.contains(path) && (files.value(path)->lastRead>QFileInfo(path).lastModified()) ) {
-                //Re-use previous data for this file (nothing changed)
-                found << files[path]->name;  //keep track of which files were already found
-            } else {
-                if(files.contains(path)) {
-                    appschanged = true;
-                    files.take(path)->deleteLater();
-                }
-                XDGDesktop *dFile = new XDGDesktop(path, this);
-                if(dFile->type!=XDGDesktop::BAD) {
-                    appschanged = true; //flag that something changed - needed to load a file
-                    if(!oldkeys.contains(path)) {
-                        newfiles << path;    //brand new file (not an update to a previously-read file)
-                    }
-                    files.insert(path, dFile);
-                    found << dFile->name;
-                } else {
-                    dFile->deleteLater(); //bad file - discard it
-                }
+            stale.remove(path); //make sure this key does not get cleaned up later
+            QFileInfo info(path);
+            if(files.contains(path) && (files.value(path)->lastRead>info.lastModified()) ) {
+                continue;    //re-use previous data for this file (nothing changed)
+            }
+            LDesktopIndex::FileStamp stamp = {info.lastModified().toMSecsSinceEpoch(), info.size()};
+            if( (badFiles.contains(path) && badFiles.value(path)==stamp) || (index.isLoaded() && index.isBad(path, stamp.mtime, stamp.size)) ) {
+                bad.insert(path, stamp); //still the same unusable file - no need to parse it again
+                continue;
             }
-            oldkeys.removeAll(path); //make sure this key does not get cleaned up later
+            desktop_job job;
+            job.desk = new XDGDesktop(""); //created on this thread - only filled in by the workers (owned by the snapshots)
+            job.desk->filePath = path;
+            job.mtime = stamp.mtime;
+            job.size = stamp.size;
+            job.restored = false;
+            jobs << job;
         } //end loop over apps
     } //end loop over appDirs
+    //Phase 2: restore/parse the changed files across the thread pool (no shared state touched here)
+    auto loadJob = [&index](desktop_job &job) {
+        job.restored = index.isLoaded() && index.restore(job.desk, job.desk->filePath, job.mtime, job.size);
+        if(!job.restored) {
+            job.desk->sync();
+        }
+    };
+    if(jobs.length() < 8 || parsePool()->maxThreadCount() < 2) {
+        for(int i=0; i<jobs.length(); i++) {
+            loadJob(jobs[i]);    //not worth the thread hand-off
+        }
+    } else {
+        QtConcurrent::blockingMap(parsePool(), jobs, loadJob);
+    }
+    index.close(); //done with the mapped file
+    //Phase 3: merge the results into the hash in one pass
+    hashmutex.lock();
+    QList<XDGDesktop*> retired; //entries being replaced/removed
+    for(int i=0; i<jobs.length(); i++) {
+        XDGDesktop *dFile = jobs[i].desk;
+        path = dFile->filePath;
+        if(!jobs[i].restored) {
+            indexchanged = true;
+        }
+        bool isnew = !files.contains(path);
+        if(!isnew) {
+            appschanged = true;
+            retired << files.take(path);
+        }
+        if(dFile->type!=XDGDesktop::BAD) {
+            appschanged = true; //flag that something changed - needed to load a file
+            if(isnew) {
+                newfiles << path;    //brand new file (not an update to a previously-read file)
+            } else {
+                changedfiles << path;
+            }
+            files.insert(path, dFile);
+        } else {
+            if(!isnew) {
+                badfiles << path;    //previously-valid file which went bad
+            }
+            bad.insert(path, LDesktopIndex::FileStamp{jobs[i].mtime, jobs[i].size}); //remember it so it does not get parsed every time
+            dFile->deleteLater(); //bad file - discard it
+        }
+    }
+    badFiles = bad; //(new ones were parsed and removed ones changed the dir listing - the index gets re-written either way)
+    oldkeys = QStringList(stale.begin(), stale.end());
     //Save the extra info to the internal lists
     if(!firstrun) {
-        removedApps = oldkeys;//files which were removed
+        removedApps = oldkeys + badfiles;//files which were removed
         newApps = newfiles; //files which were added
     }
     //Now go through and cleanup any old keys where the associated file does not exist anymore
@@ -882,55 +1647,204 @@ void XDGDesktopList::updateList() {
             appschanged = true;
         }
         //files.remove(oldkeys[i]);
-        files.take(oldkeys[i])->deleteLater();
+        retired << files.take(oldkeys[i]);
+    }
+    scanDirs = appDirs;
+    if(appschanged || !snapshot()) {
+        publish(retired);
+    }
+    //Keep the on-disk index current for the next startup (any process linking lib7b7b can use it)
+    if(indexchanged || (appschanged && !firstrun)) {
+        LDesktopIndex::save(files, listing, badFiles);
     }
     //If this class is automatically managing the lists, update the watched files/dirs and send out notifications
-    if(watcher!=0) {
-        if(appschanged) {
-            qDebug() << "Auto App List Update:" << lastCheck  << "Files Found:" << files.count();
-        }
-        watcher->removePaths(QStringList() << watcher->files() << watcher->directories());
-        watcher->addPaths(appDirs);
+    // (no polling - later changes arrive through the dir watches)
+    if(keepsynced) {
         if(appschanged) {
-            emit appsUpdated();
+            qDebug() << "Auto App List Update:" << lastCheck  << "Files Found:" << files.count() << "Translation Tables:" << XDGDesktop::localeDataSize()/1024 << "KB";
         }
-        synctimer->setInterval(60000); //Update in 1 minute if nothing changes before then
-        synctimer->start();
+        updateWatches(appDirs);
     }
     hashmutex.unlock();
+    if(keepsynced && appschanged) {
+        emit appsUpdated(newfiles, oldkeys + badfiles, changedfiles);
+    }
 }
 
-QList<XDGDesktop*> XDGDesktopList::apps(bool showAll, bool showHidden) {
-    //showAll: include invalid files, showHidden: include NoShow/Hidden files
-    //hashmutex.lock();
-    QStringList keys = files.keys();
+static QList<XDGDesktop*> filterApps(const XDGDesktopSnapshotPtr &snap, bool showAll, bool showHidden) {
     QList<XDGDesktop*> out;
-    for(int i=0; i<keys.length(); i++) {
-        if( showHidden || !files[keys[i]]->isHidden ) { //this is faster than the "checkValidity()" function below  - so always filter here first
-            if( files[keys[i]]->isValid(showAll) ) {
-                out << files[keys[i]];
+    if(!snap) {
+        return out;
+    }
+    for(QHash<QString, XDGDesktop*>::const_iterator it = snap->files.constBegin(); it!=snap->files.constEnd(); ++it) {
+        if( showHidden || !it.value()->isHidden ) { //this is faster than the "checkValidity()" function below  - so always filter here first
+            if( it.value()->isValid(showAll) ) {
+                out << it.value();
             }
         }
     }
-    //hashmutex.unlock();
     return out;
 }
 
+QList<XDGDesktop*> XDGDesktopList::apps(bool showAll, bool showHidden) {
+    //showAll: include invalid files, showHidden: include NoShow/Hidden files
+    return filterApps(snapshot(), showAll, showHidden);
+}
+
+void XDGDesktopList::setLocale(QString locale) {
+    if(locale==XDGDesktop::activeLocale()) {
+        return;
+    }
+    XDGDesktop::setActiveLocale(locale);
+    hashmutex.lock();
+    int reread = 0;
+    //Published snapshots keep using the current entries - re-label copies and retire the old ones with the snapshot
+    QList<XDGDesktop*> old;
+    for(QHash<QString, XDGDesktop*>::iterator it = files.begin(); it!=files.end(); ++it) {
+        XDGDesktop *desk = it.value()->clone();
+        if(!desk->relabel(locale)) {
+            //Translations were not kept for this one - read it again from scratch
+            delete desk;
+            desk = new XDGDesktop(it.key());
+            reread++;
+        }
+        old << it.value();
+        it.value() = desk;
+    }
+    publish(old);
+    LDesktopIndex::save(files, listing, badFiles);
+    hashmutex.unlock();
+    qDebug() << "App Locale Switched:" << locale << "Re-read:" << reread << "of" << files.count() << "Translation Tables:" << XDGDesktop::localeDataSize()/1024 << "KB";
+}
+
+QList<XDGDesktop*> XDGDesktopList::search(QString query, int max) {
+    QMutexLocker lock(&cachemutex);
+    XDGDesktopSnapshotPtr snap = snapshot();
+    if(searchsnap!=snap) {
+        searchsnap = snap; //keeps the indexed entries alive
+        searchindex.build( filterApps(snap, false, false) );
+    }
+    return searchindex.search(query, max);
+}
+
 XDGDesktop* XDGDesktopList::findAppFile(QString filename) {
-    //hashmutex.lock();
-    QStringList keys = files.keys().filter(filename);
-    QString chk = filename.section("/",-1);
-    XDGDesktop *found = 0;
-    for(int i=0; i<keys.length(); i++) {
-        if(keys[i] == filename || keys[i].endsWith("/"+chk)) {
-            found = files[keys[i]];
-        }
+    QMutexLocker lock(&cachemutex);
+    updateLookups();
+    if(lookupsnap && lookupsnap->files.contains(filename)) {
+        return lookupsnap->files.value(filename);
+    }
+    if(filename.contains("/")) {
+        return 0;    //path which is not one of the known files - never a different file with the same name
+    }
+    return byBasename.value(filename, 0);
+}
+
+XDGDesktop* XDGDesktopList::findAppByID(QString id) {
+    QMutexLocker lock(&cachemutex);
+    updateLookups();
+    return byID.value(id, 0);
+}
+
+XDGDesktop* XDGDesktopList::findAppForWindowClass(QString wmclass) {
+    if(wmclass.isEmpty()) {
+        return 0;
+    }
+    QMutexLocker lock(&cachemutex);
+    updateLookups();
+    wmclass = wmclass.toLower();
+    XDGDesktop *found = byWMClass.value(wmclass, 0);
+    if(found==0) {
+        found = byExecName.value(wmclass, 0);
+    }
+    if(found==0) {
+        found = byIDLower.value(wmclass+".desktop", 0);
     }
-    //hashmutex.unlock();
-    //No matches
     return found;
 }
 
+QStringList XDGDesktopList::findAppsForMime(QString mime) {
+    QStringList out = LMimeApps::instance()->availableApps(mime);
+    QMutexLocker lock(&cachemutex);
+    updateLookups();
+    QList<XDGDesktop*> found = byMime.value(mime);
+    for(int i=0; i<found.length(); i++) {
+        if(!out.contains(found[i]->filePath)) {
+            out << found[i]->filePath;
+        }
+    }
+    return out;
+}
+
+void XDGDesktopList::updateLookups() {
+    //cachemutex must already be locked
+    XDGDesktopSnapshotPtr snap = snapshot();
+    if(lookupsnap==snap) {
+        return;
+    }
+    lookupsnap = snap;
+    byBasename.clear();
+    byID.clear();
+    byIDLower.clear();
+    byWMClass.clear();
+    byExecName.clear();
+    byMime.clear();
+    QHash<QString, int> dirPriority;
+    if(!snap) {
+        return;
+    }
+    for(int i=0; i<snap->dirs.length(); i++) {
+        dirPriority.insert(snap->dirs[i], i);
+    }
+    //Priority for each key in the tables (lower number wins - same as the order of the dirs)
+    QHash<QString, int> basePri, idPri, idLowerPri, wmPri, execPri;
+    for(QHash<QString, XDGDesktop*>::const_iterator it = snap->files.constBegin(); it!=snap->files.constEnd(); ++it) {
+        const QString &path = it.key();
+        XDGDesktop *desk = it.value();
+        int pri = dirPriority.value(path.section("/",0,-2), snap->dirs.length());
+        QString base = path.section("/",-1);
+        if(!basePri.contains(base) || pri<basePri.value(base)) {
+            basePri.insert(base, pri);
+            byBasename.insert(base, desk);
+        }
+        int index = path.lastIndexOf("/applications/");
+        QString id = (index<0) ? base : path.mid(index+14).replace("/","-");
+        if(!idPri.contains(id) || pri<idPri.value(id)) {
+            idPri.insert(id, pri);
+            byID.insert(id, desk);
+        }
+        QString lowid = id.toLower(); //window classes rarely match the case of the ID (org.gnome.Nautilus)
+        if(!idLowerPri.contains(lowid) || pri<idLowerPri.value(lowid)) {
+            idLowerPri.insert(lowid, pri);
+            byIDLower.insert(lowid, desk);
+        }
+        //Window matching is only useful for launchable apps
+        if(desk->type!=XDGDesktop::APP || desk->isHidden) {
+            continue;
+        }
+        QString wm = desk->startupWM.toLower();
+        if(!wm.isEmpty() && (!wmPri.contains(wm) || pri<wmPri.value(wm)) ) {
+            wmPri.insert(wm, pri);
+            byWMClass.insert(wm, desk);
+        }
+        QString bin = desk->exec.section(" ",0,0,QString::SectionSkipEmpty);
+        bin = bin.remove('"').remove('\'').section("/",-1).toLower();
+        if(!bin.isEmpty() && bin!="env" && (!execPri.contains(bin) || pri<execPri.value(bin)) ) {
+            execPri.insert(bin, pri);
+            byExecName.insert(bin, desk);
+        }
+    }
+    //Mimetypes: only the entry which won each desktop ID
+    for(QHash<QString, XDGDesktop*>::const_iterator it = byID.constBegin(); it!=byID.constEnd(); ++it) {
+        XDGDesktop *desk = it.value();
+        if(desk->type!=XDGDesktop::APP || desk->isHidden) {
+            continue;
+        }
+        for(int i=0; i<desk->mimeList.length(); i++) {
+            byMime[desk->mimeList[i]] << desk;
+        }
+    }
+}
+
 void XDGDesktopList::populateMenu(QMenu *topmenu, bool byCategory) {
     topmenu->clear();
     if(byCategory) {
@@ -1026,24 +1940,23 @@ bool LXDG::checkExec(QString exec) {
         return QFile::exists(exec);
     }
     else {
-        QStringList paths = QString(getenv("PATH")).split(":");
-        for(int i=0; i<paths.length(); i++) {
-            if(QFile::exists(paths[i]+"/"+exec)) {
-                return true;
-            }
-        }
+        return LPathResolver::instance()->exists(exec);
     }
-    return false; //could not find the executable in the current path(s)
 }
 
-QStringList LXDG::systemApplicationDirs() {
-    //Returns a list of all the directories where *.desktop files can be found
+static QStringList appDataDirs() {
     QStringList appDirs = QString(getenv("XDG_DATA_HOME")).split(":");
     appDirs << QString(getenv("XDG_DATA_DIRS")).split(":");
     if(appDirs.isEmpty()) {
         appDirs << "/usr/local/share" << "/usr/share" << LOS::AppPrefix()+"/share" << LOS::SysPrefix()+"/share" << L_SHAREDIR;
     }
     appDirs.removeDuplicates();
+    return appDirs;
+}
+
+QStringList LXDG::systemApplicationDirs() {
+    //Returns a list of all the directories where *.desktop files can be found
+    QStringList appDirs = appDataDirs();
     //Now create a valid list
     QStringList out;
     for(int i=0; i<appDirs.length(); i++) {
@@ -1062,47 +1975,12 @@ QHash<QString,QList<XDGDesktop*> > LXDG::sortDesktopCats(QList<XDGDesktop*> apps
     //Sort the list of applications into their different categories (main categories only)
     //Create the category lists
     QList<XDGDesktop*> multimedia, dev, ed, game, graphics, network, office, science, settings, sys, utility, other, wine;
-    //Sort the apps into the lists
+    QList<XDGDesktop*> *lists[XDGDesktop::CAT_COUNT+1] = { &multimedia, &dev, &ed, &game, &graphics, &network, &office, &science, &settings, &sys, &utility, &wine, &other };
+    //Sort the apps into the lists (first main category in priority order wins)
     for(int i=0; i<apps.length(); i++) {
-        if(apps[i]->catList.contains("AudioVideo")) {
-            multimedia << apps[i];
-        }
-        else if(apps[i]->catList.contains("Development")) {
-            dev << apps[i];
-        }
-        else if(apps[i]->catList.contains("Education")) {
-            ed << apps[i];
-        }
-        else if(apps[i]->catList.contains("Game")) {
-            game << apps[i];
-        }
-        else if(apps[i]->catList.contains("Graphics")) {
-            graphics << apps[i];
-        }
-        else if(apps[i]->catList.contains("Network")) {
-            network << apps[i];
-        }
-        else if(apps[i]->catList.contains("Office")) {
-            office << apps[i];
-        }
-        else if(apps[i]->catList.contains("Science")) {
-            science << apps[i];
-        }
-        else if(apps[i]->catList.contains("Settings")) {
-            settings << apps[i];
-        }
-        else if(apps[i]->catList.contains("System")) {
-            sys << apps[i];
-        }
-        else if(apps[i]->catList.contains("Utility")) {
-            utility << apps[i];
-        }
-        else if(apps[i]->catList.contains("Wine")) {
-            wine << apps[i];
-        }
-        else {
-            other << apps[i];
-        }
+        quint32 mask = apps[i]->categoryMask();
+        int cat = (mask==0) ? XDGDesktop::CAT_COUNT : __builtin_ctz(mask);
+        *lists[cat] << apps[i];
     }
     //Now create the output hash
     QHash<QString,QList<XDGDesktop*> > out;
@@ -1221,8 +2099,10 @@ QIcon LXDG::findIcon(QString iconName, QString fallback) {
 
 	QIcon ico;
 	ico = QIcon::fromTheme(iconName);
-
-	if(ico.isNull() && !fallback.isEmpty()) {
+	if(!ico.isNull()) {
+		ico = LIconSharedCache::themeIcon(iconName, ico);    //rendered sizes are shared with the other processes
+	}
+	else if(!fallback.isEmpty()) {
 		ico = LXDG::findIcon(fallback,"");
 	}
 	return ico;
@@ -1318,72 +2198,34 @@ QIcon LXDG::findMimeIcon(QString extension) {
     return ico;
 }
 
-QString LXDG::findAppMimeForFile(QString filename, bool multiple) {
+//Mimetype detection against a single snapshot of the database
+static QString mimeForFile(const LMimeGlobs *globs, QString filename, bool multiple) {
     QString out;
-    QString extension = filename.section(".",1,-1);
-    if("."+extension == filename) {
+    //Just in case the filename is a mimetype itself
+    if(globs->isMimeType(filename)) {
+        return filename;
+    }
+    //Only the name is matched for full paths (the directories might have dots in them too)
+    QString name = filename.startsWith("/") ? filename.section("/",-1) : filename;
+    QString extension = name.section(".",1,-1);
+    if("."+extension == name) {
         extension.clear();    //hidden file without extension
     }
     //qDebug() << "MIME SEARCH:" << filename << extension;
-    QStringList mimefull = LXDG::loadMimeFileGlobs2();
-    QStringList mimes;
-    //Just in case the filename is a mimetype itself
-    if( mimefull.filter(":"+filename+":").length() == 1) {
-        return filename;
+    if(!extension.isEmpty() && globs->isMimeType(extension)) {
+        return extension;
     }
-    while(mimes.isEmpty()) {
-        //Check for an exact mimetype match
-        if(mimefull.filter(":"+extension+":").length() == 1) {
-            return extension;
-        }
-        //Look for globs at the end of the filename
-        if(!extension.isEmpty()) {
-            mimes = mimefull.filter(":*."+extension);
-            //If nothing found, try a case-insensitive search
-            if(mimes.isEmpty()) {
-                mimes = mimefull.filter(":*."+extension, Qt::CaseInsensitive);
-            }
-            //Now ensure that the filter was accurate (*.<extention>.<something> will still be caught)
-            for(int i=0; i<mimes.length(); i++) {
-                if(!filename.endsWith( mimes[i].section(":*",-1), Qt::CaseInsensitive )) {
-                    mimes.removeAt(i);
-                    i--;
-                }
-                else if(mimes[i].section(":",0,0).length()==2) {
-                    mimes[i].prepend("0");    //ensure 3-character priority number
-                }
-                else if(mimes[i].section(":",0,0).length()==1) {
-                    mimes[i].prepend("00");    //ensure 3-character priority number
-                }
-            }
-        }
-        //Look for globs at the start of the filename
-        if(mimes.isEmpty()) {
-            mimes = mimefull.filter(":"+filename.left(2)); //look for the first 2 characters initially
-            //Note: This initial filter will only work if the wildcard (*) is not within the first 2 characters of the pattern
-            //Now ensure that the filter was accurate
-            for(int i=0; i<mimes.length(); i++) {
-                if(!filename.startsWith( mimes[i].section(":",3,-1,QString::SectionSkipEmpty).section("*",0,0), Qt::CaseInsensitive )) {
-                    mimes.removeAt(i);
-                    i--;
-                }
-            }
+    bool tied = false;
+    QStringList matches = globs->match(name, &tied); //already in weight order
+    //Look at the file contents only when the name is not conclusive (nothing matched, or a tie for first place)
+    if(filename.startsWith("/") && (matches.isEmpty() || tied) ) {
+        QString sniffed = globs->sniffFile(filename);
+        if(matches.isEmpty() && !sniffed.isEmpty()) {
+            matches << sniffed;
         }
-        if(mimes.isEmpty()) {
-            if(extension.contains(".")) {
-                extension = extension.section(".",1,-1);
-            }
-            else {
-                break;
-            }
+        else if(matches.contains(sniffed)) {
+            matches.move(matches.indexOf(sniffed), 0);
         }
-    } //end of mimes while loop
-    mimes.sort(); //this automatically puts them in reverse weight order (100 on down)
-    QStringList matches;
-    //qDebug() << "Mimes:" << mimes;
-    for(int m=mimes.length()-1; m>=0; m--) {
-        QString mime = mimes[m].section(":",1,1,QString::SectionSkipEmpty);
-        matches << mime;
     }
     //qDebug() << "Matches:" << matches;
     if(multiple && !matches.isEmpty() ) {
@@ -1393,8 +2235,11 @@ QString LXDG::findAppMimeForFile(QString filename, bool multiple) {
         out = matches.first();
     }
     else { //no mimetype found - assign one (internal only - no system database changes)
+        if(extension.contains(".")) {
+            extension = extension.section(".",-1);
+        }
         if(extension.isEmpty()) {
-            out = "unknown/"+filename.toLower();
+            out = "unknown/"+name.toLower();
         }
         else {
             out = "unknown/"+extension.toLower();
@@ -1404,6 +2249,76 @@ QString LXDG::findAppMimeForFile(QString filename, bool multiple) {
     return out;
 }
 
+QString LXDG::findAppMimeForFile(QString filename, bool multiple) {
+    std::shared_ptr<const LMimeGlobs> globs = loadMimeGlobs();
+    return mimeForFile(globs.get(), filename, multiple);
+}
+
+//Lookups shared by all the files in one classification run
+struct filetype_lookups {
+    std::shared_ptr<const LMimeGlobs> globs;
+    QSet<QString> images; //image file extensions (lowercase)
+    QMutex mutex;
+    QHash<QString, QPair<QString, QString> > icons; //mimetype -> (icon, generic icon)
+};
+
+static std::shared_ptr<filetype_lookups> newFileTypeLookups() {
+    std::shared_ptr<filetype_lookups> lookups = std::make_shared<filetype_lookups>();
+    lookups->globs = LXDG::loadMimeGlobs();
+    QStringList images = LUtils::imageExtensions();
+    for(int i=0; i<images.length(); i++) {
+        lookups->images.insert(images[i]);
+    }
+    return lookups;
+}
+
+static XDGFileType classifyWith(filetype_lookups *lookups, QString path) {
+    XDGFileType type;
+    QFileInfo info(path);
+    type.path = info.absoluteFilePath();
+    type.isSymLink = info.isSymLink();
+    type.isDir = info.isDir();
+    type.isImage = false;
+    if(type.isDir) {
+        type.mime = "inode/directory";
+        type.icon = "folder";
+        type.genericIcon = "folder";
+        return type;
+    }
+    type.isImage = lookups->images.contains(info.suffix().toLower());
+    type.mime = mimeForFile(lookups->globs.get(), type.path, false);
+    //Files of the same type all get the same icon names
+    QMutexLocker lock(&lookups->mutex);
+    if(!lookups->icons.contains(type.mime)) {
+        lookups->icons.insert(type.mime, qMakePair(lookups->globs->iconName(type.mime), lookups->globs->genericIconName(type.mime)) );
+    }
+    QPair<QString, QString> icons = lookups->icons.value(type.mime);
+    type.icon = icons.first;
+    type.genericIcon = icons.second;
+    return type;
+}
+
+XDGFileType LXDG::classifyFile(QString path) {
+    std::shared_ptr<filetype_lookups> lookups = newFileTypeLookups();
+    return classifyWith(lookups.get(), path);
+}
+
+QList<XDGFileType> LXDG::classifyFiles(QStringList paths) {
+    std::shared_ptr<filetype_lookups> lookups = newFileTypeLookups();
+    auto job = [lookups](const QString &path) {
+        return classifyWith(lookups.get(), path);
+    };
+    return QtConcurrent::blockingMapped<QList<XDGFileType> >(paths, job);
+}
+
+QFuture<XDGFileType> LXDG::classifyFilesAsync(QStringList paths) {
+    std::shared_ptr<filetype_lookups> lookups = newFileTypeLookups();
+    auto job = [lookups](const QString &path) {
+        return classifyWith(lookups.get(), path);
+    };
+    return QtConcurrent::mapped(paths, job);
+}
+
 QStringList LXDG::findFilesForMime(QString mime) {
     QStringList out;
     QStringList mimes = LXDG::loadMimeFileGlobs2().filter(mime);
@@ -1418,204 +2333,58 @@ QStringList LXDG::listFileMimeDefaults() {
     //This will spit out a itemized list of all the mimetypes and relevant info
     // Output format: <mimetype>::::<extension>::::<default>::::<localized comment>
     QStringList mimes = LXDG::loadMimeFileGlobs2();
-    //Remove all the application files from the list (only a single app defines/uses this type in general)
-    /*QStringList apps = mimes.filter(":application/");
-    //qDebug() << "List Mime Defaults";
-    for(int i=0; i<apps.length(); i++){ mimes.removeAll(apps[i]); }*/
-    //Now start filling the output list
-    QStringList out;
+    //Collect all the different extensions for each mimetype in a single pass (keep the database order)
+    QStringList types;
+    QHash<QString, QStringList> extensions;
     for(int i=0; i<mimes.length(); i++) {
         QString mimetype = mimes[i].section(":",1,1);
-        QStringList tmp = mimes.filter(mimetype);
-        //Collect all the different extensions with this mimetype
-        QStringList extlist;
-        for(int j=0; j<tmp.length(); j++) {
-            mimes.removeAll(tmp[j]);
-            extlist << tmp[j].section(":",2,2);
-        }
-        extlist.removeDuplicates(); //just in case
+        QString ext = mimes[i].section(":",2,2);
+        if(!extensions.contains(mimetype)) {
+            types << mimetype;
+        }
+        QStringList &extlist = extensions[mimetype];
+        if(!extlist.contains(ext)) {
+            extlist << ext;
+        }
+    }
+    //Now start filling the output list
+    QStringList out;
+    for(int i=0; i<types.length(); i++) {
         //Now look for a current default for this mimetype
-        QString dapp = LXDG::findDefaultAppForMime(mimetype); //default app;
-
+        QString dapp = LXDG::findDefaultAppForMime(types[i]); //default app;
         //Create the output entry
-        //qDebug() << "Mime entry:" << i << mimetype << dapp;
-        out << mimetype+"::::"+extlist.join(", ")+"::::"+dapp+"::::"+LXDG::findMimeComment(mimetype);
-
-        i--; //go back one (continue until the list is empty)
+        //qDebug() << "Mime entry:" << i << types[i] << dapp;
+        out << types[i]+"::::"+extensions.value(types[i]).join(", ")+"::::"+dapp+"::::"+LXDG::findMimeComment(types[i]);
     }
     return out;
 }
 
 QString LXDG::findMimeComment(QString mime) {
-    QString comment;
-    QStringList dirs = LXDG::systemMimeDirs();
-    QString lang = QString(getenv("LANG")).section(".",0,0);
-    QString shortlang = lang.section("_",0,0);
-    for(int i=0; i<dirs.length(); i++) {
-        if(QFile::exists(dirs[i]+"/"+mime+".xml")) {
-            QStringList info = LUtils::readFile(dirs[i]+"/"+mime+".xml");
-            QStringList filter = info.filter("<comment xml:lang=\""+lang+"\">");
-            //First look for a full language match, then short language, then general comment
-            if(filter.isEmpty()) {
-                filter = info.filter("<comment xml:lang=\""+shortlang+"\">");
-            }
-            if(filter.isEmpty()) {
-                filter = info.filter("<comment>");
-            }
-            if(!filter.isEmpty()) {
-                comment = filter.first().section(">",1,1).section("</",0,0);
-                break;
-            }
-        }
-    }
-    return comment;
+    //Table built from all the packages/*.xml files at once (cached on disk)
+    return LMimeComments::instance()->comment(mime);
 }
 
 QString LXDG::findDefaultAppForMime(QString mime) {
-    //First get the priority-ordered list of default file locations
-    QStringList dirs;
-    dirs << QString(getenv("XDG_CONFIG_HOME"))+"/7b7b-mimeapps.list" \
-         << QString(getenv("XDG_DATA_HOME"))+"/applications/7b7b-mimeapps.list" \
-         << QString(getenv("XDG_CONFIG_HOME"))+"/mimeapps.list" \
-         << QString(getenv("XDG_DATA_HOME"))+"/applications/mimeapps.list";
-    QStringList tmp = QString(getenv("XDG_CONFIG_DIRS")).split(":");
-    for(int i=0; i<tmp.length(); i++) {
-        dirs << tmp[i]+"/7b7b-mimeapps.list";
-        dirs << tmp[i]+"/mimeapps.list";
-    }
-    tmp = QString(getenv("XDG_DATA_DIRS")).split(":");
-    for(int i=0; i<tmp.length(); i++) {
-        dirs << tmp[i]+"/applications/7b7b-mimeapps.list";
-        dirs << tmp[i]+"/applications/mimeapps.list";
-    }
-
-    //Now go through all the files in order of priority until a default is found
-    QString cdefault;
-    for(int i=0; i<dirs.length() && cdefault.isEmpty(); i++) {
-        if(!QFile::exists(dirs[i])) {
-            continue;
-        }
-        QStringList info = LUtils::readFile(dirs[i]);
-        if(info.isEmpty()) {
-            continue;
-        }
-        QStringList white; //lists to keep track of during the search (black unused at the moment)
-        QString workdir = dirs[i].section("/",0,-2); //just the directory
-        // qDebug() << "Check File:" << mime << dirs[i] << workdir;
-        int def = info.indexOf("[Default Applications]"); //find this line to start on
-        if(def>=0) {
-            for(int d=def+1; d<info.length(); d++) {
-                //qDebug() << "Check Line:" << info[d];
-                if(info[d].startsWith("[")) {
-                    break;    //starting a new section now - finished with defaults
-                }
-                if(info[d].contains(mime+"=") ) {
-                    white = info[d].section("=",1,-1).split(";") + white; //exact mime match - put at front of list
-                    break; //already found exact match
-                } else if(info[d].contains("*") && info[d].contains("=") ) {
-                    //QRegExp rg(info[d].section("=",0,0), Qt::CaseSensitive, QRegExp::WildcardUnix);
-                    QRegularExpression rg(info[d].section("=",0,0));
-                    //if(rg.exactMatch(mime)){
-
-                    if(rg.match(mime).hasMatch()) {
-                        white << info[d].section("=",1,-1).split(";"); //partial mime match - put at end of list
-                    }
-                }
-            }
-        }
-        // Now check for any white-listed files in this work dir
-        // find the full path to the file (should run even if nothing in this file)
-        //qDebug() << "WhiteList:" << white;
-        for(int w=0; w<white.length(); w++) {
-            if(white[w].isEmpty()) {
-                continue;
-            }
-            //First check for absolute paths to *.desktop file
-            if( white[w].startsWith("/") ) {
-                if( QFile::exists(white[w]) ) {
-                    cdefault=white[w];
-                    break;
-                }
-                else {
-                    white.removeAt(w);    //invalid file path - remove it from the list
-                    w--;
-                }
-            }
-            //Now check for relative paths to  file (in current priority-ordered work dir)
-            else if( QFile::exists(workdir+"/"+white[w]) ) {
-                cdefault=workdir+"/"+white[w];
-                break;
-            }
-            //Now go through the XDG DATA dirs and see if the file is in there
-            else {
-                white[w] = LUtils::AppToAbsolute(white[w]);
-                if(QFile::exists(white[w])) {
-                    cdefault = white[w];
-                }
-            }
-        }
-    } //End loop over files
-
-    return cdefault;
+    //Priority-ordered (7b7b-)mimeapps.list files - parsed once and cached
+    return LMimeApps::instance()->defaultApp(mime);
 }
 
 QStringList LXDG::findAvailableAppsForMime(QString mime) {
-    QStringList dirs = LXDG::systemApplicationDirs();
-    QStringList out;
-    //Loop over all possible directories that contain *.destop files
-    //  and check for the mimeinfo.cache file
-    for(int i=0; i<dirs.length(); i++) {
-        if(QFile::exists(dirs[i]+"/mimeinfo.cache")) {
-            QStringList matches = LUtils::readFile(dirs[i]+"/mimeinfo.cache").filter(mime+"=");
-            //Find any matches for our mimetype in the cache
-            for(int j=0; j<matches.length(); j++) {
-                QStringList files = matches[j].section("=",1,1).split(";",Qt::SkipEmptyParts);
-                //Verify that each file exists before putting the full path to the file in the output
-                for(int m=0; m<files.length(); m++) {
-                    if(QFile::exists(dirs[i]+"/"+files[m])) {
-                        out << dirs[i]+"/"+files[m];
-                    } else if(files[m].contains("-")) { //kde4-<filename> -> kde4/<filename> (stupid KDE variations!!)
-                        files[m].replace("-","/");
-                        if(QFile::exists(dirs[i]+"/"+files[m])) {
-                            out << dirs[i]+"/"+files[m];
-                        }
-                    }
-                }
-            }
-        }
-    }
-    //qDebug() << "Found Apps for Mime:" << mime << out << dirs;
-    return out;
+    //Index of all the mimeinfo.cache files in the application dirs (kept current with watches),
+    // plus the MimeType= keys of the entries which mimeinfo.cache does not list (yet)
+    // Only entries which are already parsed get merged in - this never scans the app dirs itself
+    return XDGDesktopList::instance()->findAppsForMime(mime);
 }
 
 void LXDG::setDefaultAppForMime(QString mime, QString app) {
     //qDebug() << "Set Default App For Mime:" << mime << app;
-    QString filepath = QString(getenv("XDG_CONFIG_HOME"))+"/7b7b-mimeapps.list";
-    QStringList cinfo = LUtils::readFile(filepath);
-    //If this is a new file, make sure to add the header appropriately
-    if(cinfo.isEmpty()) {
-        cinfo << "#Automatically generated with 7b7b-config" << "# DO NOT CHANGE MANUALLY" << "[Default Applications]";
-    }
-    //Check for any current entry for this mime type
-    QStringList tmp = cinfo.filter(mime+"=");
-    int index = -1;
-    if(!tmp.isEmpty()) {
-        index = cinfo.indexOf(tmp.first());
-    }
-    //Now add the new default entry (if necessary)
-    if(app.isEmpty()) {
-        if(index>=0) {
-            cinfo.removeAt(index);    //Remove entry
-        }
-    } else {
-        if(index<0) {
-            cinfo << mime+"="+app+";"; //new entry
-        } else {
-            cinfo[index] = mime+"="+app+";"; //overwrite existing entry
-        }
-    }
-    LUtils::writeFile(filepath, cinfo, true);
-    return;
+    QHash<QString, QString> defaults;
+    defaults.insert(mime, app);
+    LMimeApps::instance()->setDefaultApps(defaults);
+}
+
+void LXDG::setDefaultAppForMimes(QHash<QString, QString> defaults) {
+    LMimeApps::instance()->setDefaultApps(defaults); //single rewrite of the file
 }
 
 QStringList LXDG::findAVFileExtensions() {
@@ -1636,36 +2405,11 @@ QStringList LXDG::findAVFileExtensions() {
 
 QStringList LXDG::loadMimeFileGlobs2() {
     //output format: <weight>:<mime type>:<file extension (*.something)>
-    if(mimeglobs.isEmpty() || (mimechecktime < (QDateTime::currentMSecsSinceEpoch()-30000)) ) {
-        //qDebug() << "Loading globs2 mime DB files";
-        mimeglobs.clear();
-        mimechecktime = QDateTime::currentMSecsSinceEpoch(); //save the current time this was last checked
-        QStringList dirs = LXDG::systemMimeDirs();
-        for(int i=0; i<dirs.length(); i++) {
-            if(QFile::exists(dirs[i]+"/globs2")) {
-                QFile file(dirs[i]+"/globs2");
-                if(!file.exists()) {
-                    continue;
-                }
-                if(!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                    continue;
-                }
-                QTextStream in(&file);
-                while(!in.atEnd()) {
-                    QString line = in.readLine();
-                    if(!line.startsWith("#")) {
-                        mimeglobs << line.simplified();
-                    }
-                }
-                file.close();
-            }
-            if(i==dirs.length()-1 && mimeglobs.isEmpty()) {
-                //Could not find the mimetype database on the system - use the fallback file distributed with 7b7b
-                dirs << LOS::LuminaShare();
-            }
-        }//end loop over dirs
-    }
-    return mimeglobs;
+    return loadMimeGlobs()->lines();
+}
+
+std::shared_ptr<const LMimeGlobs> LXDG::loadMimeGlobs() {
+    return LMimeDatabase::instance()->globs();
 }
 
 //Find all the autostart *.desktop files
@@ -31,6 +31,15 @@
 #include <QMenu>
 #include <QAction>
 #include <QMutex>
+#include <QSocketNotifier>
+#include <QFuture>
+
+#include <atomic>
+#include <memory>
+
+#include "LDesktopIndex.h"
+#include "LDesktopSearch.h"
+#include "LMimeGlobs.h"
 
 // ======================
 // FreeDesktop Desktop Actions Framework (data structure)
@@ -50,6 +59,10 @@ class XDGDesktop : public QObject {
     Q_OBJECT
 public:
     enum XDGDesktopType { BAD, APP, LINK, DIR };
+    //Main categories (bit positions within categoryMask(), in sorting priority order)
+    enum XDGCategory { CAT_AUDIOVIDEO, CAT_DEVELOPMENT, CAT_EDUCATION, CAT_GAME, CAT_GRAPHICS, CAT_NETWORK, CAT_OFFICE,
+                       CAT_SCIENCE, CAT_SETTINGS, CAT_SYSTEM, CAT_UTILITY, CAT_WINE, CAT_COUNT
+                     };
 
     //Admin variables
     QString filePath; //which file this structure contains the information for (absolute path)    
@@ -72,11 +85,29 @@ public:
 
     //Constructor/destructor
     explicit XDGDesktop(QString filePath="", QObject *parent = 0);
-    ~XDGDesktop() {}
+    ~XDGDesktop();
 
     //Functions for using this structure in various ways
     void sync(); //syncronize this structure with the backend file(as listed in the "filePath" variable)
     bool isValid(bool showAll = true); //See if this is a valid .desktop entry (showAll: don't filter out based on DE exclude/include lists)
+    void compact(); //share repeated strings with other entries (run automatically by sync())
+    quint32 categoryMask() const; //main categories found in catList (1<<XDGCategory)
+    XDGDesktop* clone(); //unparented copy (to change an entry which published snapshots still use - the copy takes over the translation table accounting)
+
+    //Localization: every Name/GenericName/Comment/Keywords translation is kept (packed) so the
+    //  active locale can be switched without reading the file again
+    bool relabel(QString locale); //returns false if the translations were not kept (use sync() instead)
+    QByteArray localeData() {
+        return localeTable;
+    }
+    bool hasLocaleData() {
+        return localeComplete;
+    }
+    void setLocaleData(const QByteArray &table, bool complete);
+    static QString activeLocale(); //locale used when reading files (default: system locale)
+    static void setActiveLocale(QString locale);
+    static qint64 localeDataSize(); //memory used by all the kept translation tables (bytes)
+    static void setLocaleBudget(qint64 bytes); //cap for localeDataSize() - entries over it only keep the active locale
 
     QString getDesktopExec(QString ActionID = ""); //Just return the exec field with minimal cleanup
     QString generateExec(QStringList inputfiles = QStringList(), QString ActionID = "");  //Format the exec command to account for input files
@@ -87,8 +118,40 @@ public:
 
     //Create a menu entry for this application
     void addToMenu(QMenu*);
+
+private:
+    QByteArray localeTable;
+    bool localeComplete; //localeTable covers every translation in the file
+    qint64 localeCharge; //bytes of localeTable counted in localeDataSize() by this entry
+
+    void applyLocale(const QByteArray &table, const QByteArray &lang);
+
+    //Memoized binary checks for isValid() (see LPathResolver::generation())
+    // <PATH generation (low 32 bits)><hash of exec/tryexec (31 bits)><result (1 bit)> - 0 if not checked yet
+    std::atomic<quint64> execMemo;
 };
 
+// ========================
+//  Immutable view of the known applications (see XDGDesktopList::snapshot())
+//  Safe to read from any thread for as long as the pointer is held: entries which get
+//  replaced/removed later are only deleted once every snapshot which can see them is gone.
+// ========================
+class XDGDesktopSnapshot {
+public:
+    QHash<QString, XDGDesktop*> files; //<filepath>/<XDGDesktop structure> (working copy - GUI thread only, other threads use snapshot())
+    QStringList dirs; //app dirs (priority order)
+
+    XDGDesktopSnapshot() {}
+    ~XDGDesktopSnapshot();
+
+private:
+    friend class XDGDesktopList;
+    //Only touched by the list when the next snapshot gets published
+    mutable QList<XDGDesktop*> retired; //entries which are not in the next snapshot
+    mutable std::shared_ptr<const XDGDesktopSnapshot> next; //newer snapshots must outlive this one (they can share entries)
+};
+typedef std::shared_ptr<const XDGDesktopSnapshot> XDGDesktopSnapshotPtr;
+
 // ========================
 //  Data Structure for keeping track of known system applications
 // ========================
@@ -101,10 +164,22 @@ public:
 
     static XDGDesktopList* instance();
 
-    //Main Interface functions
+    //Cap the number of worker threads used to parse *.desktop files (<1: one per core)
+    static void setParseThreads(int max);
+    static int parseThreads();
+
+    //Main Interface functions (safe to use from any thread)
+    XDGDesktopSnapshotPtr snapshot(); //current published view of the list
     QList<XDGDesktop*> apps(bool showAll, bool showHidden); //showAll: include invalid files, showHidden: include NoShow/Hidden files
-    XDGDesktop* findAppFile(QString filename);
+    XDGDesktop* findAppFile(QString filename); //full path (known files only) or file name (highest-priority dir wins)
+    XDGDesktop* findAppByID(QString id); //desktop file ID ("kde4-foo.desktop" for <apps dir>/kde4/foo.desktop)
+    XDGDesktop* findAppForWindowClass(QString wmclass); //StartupWMClass, then exec binary name, then desktop ID (case-insensitive)
+    QStringList findAppsForMime(QString mime); //*.desktop paths from the mimeinfo.cache files and the MimeType= of the parsed entries
     void populateMenu(QMenu *, bool byCategory = true);
+    //Ranked type-to-launch search over the valid, non-hidden apps (best matches first)
+    QList<XDGDesktop*> search(QString query, int max = 10);
+    //Switch all the entries to another locale (re-labels in memory where possible)
+    void setLocale(QString locale);
 
     //Administration variables (not typically used directly)
     QDateTime lastCheck;
@@ -112,18 +187,64 @@ public:
     QHash<QString, XDGDesktop*> files; //<filepath>/<XDGDesktop structure>
 
 public slots:
-    void updateList(); //run the check routine
+    void updateList(); //run the check routine (full rescan of all the app dirs)
 
 private:
-    QFileSystemWatcher *watcher;
+    //Pending change for a single *.desktop file (queued from the dir watches)
+    enum change_op { CHANGE_CREATE, CHANGE_MODIFY, CHANGE_DELETE };
+
+    //Work item for the parallel parse phase of updateList()
+    struct desktop_job {
+        XDGDesktop *desk;
+        qint64 mtime, size;
+        bool restored; //loaded from the on-disk index instead of parsed
+    };
+
+    QFileSystemWatcher *watcher; //fallback if inotify is not available
+    int inotifyFD;
+    QSocketNotifier *inotifyNotifier;
+    QHash<int, QString> watchDirs; //inotify watch descriptor -> directory
+    QHash<int, QString> missingParents; //inotify watch descriptor -> closest existing parent of app dirs which do not exist yet
+    QStringList missingDirs; //app dirs which do not exist yet
+    QHash<QString, change_op> pendingChanges; //<filepath>/<last operation seen>
+    bool fullRescan; //directory layout changed (or events were lost) - rescan everything
+    QHash<QString, LDesktopIndex::DirListing> listing; //dir listings from the last scan (kept for the on-disk index)
+    QHash<QString, LDesktopIndex::FileStamp> badFiles; //files which did not give a usable entry (skipped until they change)
+    XDGDesktopSnapshotPtr current; //only accessed through the std::atomic_* functions
+    QStringList scanDirs; //app dirs from the last scan (priority order)
+    void publish(QList<XDGDesktop*> retired); //publish "files" as the new snapshot
+    //Secondary lookup tables (rebuilt lazily from the latest snapshot)
+    QMutex cachemutex;
+    XDGDesktopSnapshotPtr lookupsnap, searchsnap; //snapshots the tables/index were built from (keeps the entries alive)
+    QHash<QString, XDGDesktop*> byBasename, byID, byIDLower, byWMClass, byExecName; //byIDLower/byWMClass/byExecName: lowercase keys
+    QHash<QString, QList<XDGDesktop*> > byMime;
+    void updateLookups();
+    LDesktopSearch searchindex;
     QTimer *synctimer;
     bool keepsynced;
     QMutex hashmutex;
 
+    void updateWatches(QStringList dirs);
+    void applyChanges();
+
 private slots:
     void watcherChanged();
+    void inotifyActivated();
+    void processChanges();
 signals:
-    void appsUpdated();
+    //Delta since the previous notification (file paths)
+    void appsUpdated(QStringList added, QStringList removed, QStringList changed);
+};
+
+// ================================
+//  Type information for a file (LXDG::classifyFile)
+// ================================
+struct XDGFileType {
+    QString path; //absolute path
+    QString mime;
+    QString icon, genericIcon; //icon names for the mimetype (use the generic one if the theme is missing the first)
+    bool isDir, isSymLink;
+    bool isImage; //can be loaded as a thumbnail
 };
 
 // ================================
@@ -176,10 +297,20 @@ public:
     static QStringList findAvailableAppsForMime(QString mime);
     //Set the default application for a mime-type
     static void setDefaultAppForMime(QString mime, QString app);
+    //Same thing for a number of mimetypes at once (<mimetype> -> <app>)
+    static void setDefaultAppForMimes(QHash<QString, QString> defaults);
     //List all the registered audio/video file extensions
     static QStringList findAVFileExtensions();
     //Load all the "globs2" mime database files
     static QStringList loadMimeFileGlobs2();
+    //Compiled version of the same database (shared and thread-safe - see LMimeDatabase)
+    static std::shared_ptr<const LMimeGlobs> loadMimeGlobs();
+    //Mimetype/icon classification of files (for directory views)
+    static XDGFileType classifyFile(QString path);
+    //Run on the thread pool - results are in the same order as the paths
+    static QList<XDGFileType> classifyFiles(QStringList paths);
+    //Same thing without blocking (use a QFutureWatcher to pick up the results as they finish)
+    static QFuture<XDGFileType> classifyFilesAsync(QStringList paths);
 
     //Find all the autostart *.desktop files
     static QList<XDGDesktop*> findAutoStartFiles(bool includeInvalid = false);